@@ -0,0 +1,28 @@
+/*
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+// -----------------------------------------------------------------------------
+// The firmware sketch in bench mode, built as an ordinary translation unit:
+// setup() initialises everything against the shims and the suite in
+// lib/SkiBench.h times the hot paths
+// -----------------------------------------------------------------------------
+#define SKI_BENCH 1
+#include "../src/SkiBeanComm.ino"
+
+void benchFirmware(uint16_t iters) {
+    setup();
+    benchSuite(iters);
+}
@@ -0,0 +1,46 @@
+/*
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+// -----------------------------------------------------------------------------
+// Host benchmarks
+//   firmware hot paths, the same suite the *-bench device envs run
+//     (lib/SkiBench.h), timed per call with min/median/p99/max
+//   pid_compute, SkiPID.h against the br3ttb library (BenchPID.cpp)
+//
+//   pio run -e native-bench && .pio/build/native-bench/program [--iters N] [--samples N]
+//
+// One JSON object per line on stdout, so two runs can be diffed.
+// -----------------------------------------------------------------------------
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+void benchFirmware(uint16_t iters);
+void benchPidCompare(size_t samples);
+
+int main(int argc, char** argv) {
+    uint16_t iters = 1000;
+    size_t samples = 200000;
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--iters") && i + 1 < argc) iters = strtoul(argv[++i], nullptr, 10);
+        else if (!strcmp(argv[i], "--samples") && i + 1 < argc) samples = strtoul(argv[++i], nullptr, 10);
+    }
+
+    benchFirmware(iters);
+    benchPidCompare(samples);
+    return 0;
+}
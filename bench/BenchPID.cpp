@@ -0,0 +1,149 @@
+/*
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+// -----------------------------------------------------------------------------
+// Host benchmark: cost of one PID Compute(), SkiPID.h against the br3ttb
+// library it replaced
+// Every controller sees the same open-loop trace - a noisy roast curve and a
+// stepped setpoint - with the firmware's default tunings, so the outputs can
+// be compared too. max_abs_diff is against br3ttb; with the derivative filter
+// and quantum off what is left is rounding and conditional integration, which
+// holds the sum back where the library lets it run into its clamp. Host cycle
+// counts only rank the arithmetic types; the gap that matters, soft-float on
+// the C6, is wider.
+//
+// Run from BenchMain.cpp; --samples N sets the trace length.
+// -----------------------------------------------------------------------------
+
+#include <Arduino.h>
+#include <PID_v1.h>
+#define SKI_PID_NO_ALIAS
+#include "../lib/SkiPID.h"
+#include "SimClock.h"
+#include <algorithm>
+#include <chrono>
+#include <vector>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define BENCH_CYCLES() __rdtsc()
+#else
+#define BENCH_CYCLES() 0ULL
+#endif
+
+namespace {
+
+const int SAMPLE_MS = 500;
+
+struct Trace {
+    std::vector<double> input;
+    std::vector<double> setpoint;
+};
+
+struct Result {
+    double nsPerCall;
+    double cyclesPerCall;
+    std::vector<double> outputs;
+};
+
+// Charge, ramp and flatten like a roast, with +/-0.3 C of sensor noise
+Trace makeTrace(size_t n) {
+    Trace t;
+    uint32_t seed = 12345;
+    for (size_t i = 0; i < n; i++) {
+        double s = (i % 2400) * SAMPLE_MS / 1000.0;      // 20 minute roasts back to back
+        double bt = 220.0 - 130.0 * exp(-s / 400.0) - 70.0 * exp(-s / 40.0);
+        seed = seed * 1664525u + 1013904223u;
+        bt += ((int)((seed >> 8) % 601) - 300) / 1000.0;
+        t.input.push_back(bt);
+        t.setpoint.push_back(s < 300 ? 150.0 : s < 700 ? 200.0 : 215.0);
+    }
+    return t;
+}
+
+template <typename Controller, typename Configure>
+Result run(const Trace& trace, Configure configure) {
+    double input = trace.input[0], output = 0, setpoint = trace.setpoint[0];
+    Controller pid(&input, &output, &setpoint, 9.0, 0.3, 2.5, P_ON_M, DIRECT);
+    pid.SetOutputLimits(0, 100);
+    pid.SetSampleTime(SAMPLE_MS);
+    configure(pid);
+    pid.SetMode(AUTOMATIC);
+
+    Result r;
+    r.outputs.reserve(trace.input.size());
+    uint64_t ns = 0, cycles = 0;
+    for (size_t i = 0; i < trace.input.size(); i++) {
+        input = trace.input[i];
+        setpoint = trace.setpoint[i];
+        sim::advanceBy(SAMPLE_MS * 1000ULL);
+
+        auto t0 = std::chrono::steady_clock::now();
+        uint64_t c0 = BENCH_CYCLES();
+        pid.Compute();
+        uint64_t c1 = BENCH_CYCLES();
+        auto t1 = std::chrono::steady_clock::now();
+
+        ns += std::chrono::duration_cast<std::chrono::nanoseconds>(t1 - t0).count();
+        cycles += c1 - c0;
+        r.outputs.push_back(output);
+    }
+    r.nsPerCall = (double)ns / trace.input.size();
+    r.cyclesPerCall = (double)cycles / trace.input.size();
+    return r;
+}
+
+// Timer overhead, taken off every result
+Result timerOverhead(size_t n) {
+    uint64_t ns = 0, cycles = 0;
+    for (size_t i = 0; i < n; i++) {
+        auto t0 = std::chrono::steady_clock::now();
+        uint64_t c0 = BENCH_CYCLES();
+        uint64_t c1 = BENCH_CYCLES();
+        auto t1 = std::chrono::steady_clock::now();
+        ns += std::chrono::duration_cast<std::chrono::nanoseconds>(t1 - t0).count();
+        cycles += c1 - c0;
+    }
+    return { (double)ns / n, (double)cycles / n, {} };
+}
+
+void report(const char* impl, const char* features, const Result& r, const Result& base, const Result& overhead) {
+    double maxDiff = 0;
+    for (size_t i = 0; i < r.outputs.size(); i++) maxDiff = std::max(maxDiff, fabs(r.outputs[i] - base.outputs[i]));
+    printf("{\"bench\":\"pid_compute\",\"impl\":\"%s\",\"features\":\"%s\",\"calls\":%zu,"
+           "\"ns_per_call\":%.1f,\"cycles_per_call\":%.1f,\"max_abs_diff\":%.4f}\n",
+           impl, features, r.outputs.size(), std::max(0.0, r.nsPerCall - overhead.nsPerCall),
+           std::max(0.0, r.cyclesPerCall - overhead.cyclesPerCall), maxDiff);
+}
+
+} // namespace
+
+void benchPidCompare(size_t samples) {
+    Trace trace = makeTrace(samples);
+    Result overhead = timerOverhead(samples);
+
+    auto plain = [](auto&) {};
+    auto full = [](auto& pid) {
+        pid.SetDerivativeFilter(0.5);
+        pid.SetOutputQuantum(5);
+    };
+
+    Result base = run<PID>(trace, plain);
+    report("br3ttb<double>", "-", base, base, overhead);
+    report("SkiPID<double>", "-", run<PIDController<double>>(trace, plain), base, overhead);
+    report("SkiPID<float>", "-", run<PIDController<float>>(trace, plain), base, overhead);
+    report("SkiPID<Fix16>", "-", run<PIDController<Fix16>>(trace, plain), base, overhead);
+    report("SkiPID<float>", "dfilter+quantum", run<PIDController<float>>(trace, full), base, overhead);
+    report("SkiPID<Fix16>", "dfilter+quantum", run<PIDController<Fix16>>(trace, full), base, overhead);
+}
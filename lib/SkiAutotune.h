@@ -0,0 +1,329 @@
+/*
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+// -----------------------------------------------------------------------------
+// PID autotune by relay feedback (Astrom-Hagglund)
+// PID;AT;<target> switches heat between the max power setting and 0 around
+// the target, with a small hysteresis band, until the bean temperature
+// settles into a steady oscillation. From its amplitude a and period Pu:
+//   Ku = 4d / (pi * sqrt(a^2 - hyst^2)),  d = half the relay swing
+// and the tunings follow from the chosen rule:
+//   ZN   Ziegler-Nichols     Kp = 0.6 Ku,   Ti = Pu / 2,   Td = Pu / 8
+//   TL   Tyreus-Luyben       Kp = Ku / 2.2, Ti = 2.2 Pu,   Td = Pu / 6.3
+// The result goes through PIDConfig (so it is saved) and onto the PID. Any
+// overshoot past AT_MAX_OVERSHOOT_CENTI, a run longer than AT_TIMEOUT_MS, a
+// stalled sensor or another heat source taking over aborts with heat off.
+//
+// RelayTuner is the bare state machine - filtered samples in, heat out - so
+// the host sim can drive it against its thermal model. Autotune is the glue
+// to the control task.
+//
+// Reading the AUTOTUNE characteristic returns AUTOTUNE_STATUS_BYTES, LE:
+//   uint8 state, uint8 result (AutotuneResult), uint8 rule, uint8 cycles,
+//   uint8 heat %, uint16 elapsed s, int16 target °C x10,
+//   uint16 amplitude °C x100, uint16 Ku %/°C x100, uint16 Pu s x10
+// -----------------------------------------------------------------------------
+
+extern double pSetpoint;
+extern char CorF;
+extern int manualHeatLevel;
+extern PID myPID;
+extern PIDConfig myPIDConfig;
+extern TempFilter tempFilter;
+void handleHEAT(uint8_t value);
+void setPIDMode(bool usePID);
+
+const int32_t  AT_HYSTERESIS_CENTI    = 50;          // relay band, +/- 0.5 °C
+const int32_t  AT_MAX_OVERSHOOT_CENTI = 1500;        // abort above target + 15 °C
+const int32_t  AT_MAX_TARGET_CENTI    = 24000;       // no tuning above 240 °C
+const uint32_t AT_TIMEOUT_MS          = 20UL * 60 * 1000;
+const uint32_t AT_SENSOR_STALE_MS     = 5000;
+const uint8_t  AT_MIN_CYCLES          = 4;           // the first one is discarded
+const uint8_t  AT_MAX_CYCLES          = 12;
+const uint8_t  AT_SETTLED_PERCENT     = 15;          // last AT_AVG_CYCLES agree within this
+const uint8_t  AT_AVG_CYCLES          = 3;
+const uint8_t  AUTOTUNE_STATUS_BYTES  = 15;
+
+enum AutotuneState { AT_IDLE, AT_RUNNING, AT_DONE, AT_ABORTED };
+
+enum AutotuneRule { AT_RULE_ZN, AT_RULE_TL };
+
+enum AutotuneResult {
+    AT_RESULT_NONE, AT_RESULT_OK, AT_RESULT_STOPPED, AT_RESULT_OVERSHOOT, AT_RESULT_TIMEOUT,
+    AT_RESULT_SENSOR, AT_RESULT_UNSETTLED
+};
+
+struct PIDTunings {
+    double kP, kI, kD;    // per °C, Ki per s, Kd in s - what PID::SetTunings() takes
+};
+
+// -----------------------------------------------------------------------------
+// Relay state machine, no globals
+// -----------------------------------------------------------------------------
+class RelayTuner {
+public:
+    void begin(int32_t targetCentiC, uint8_t high, uint8_t rule, uint32_t nowMs);
+    uint8_t step(int32_t centiC, uint32_t nowMs);   // one filtered sample, returns heat %
+    void abort(uint8_t why);
+
+    uint8_t state() const { return st; }
+    uint8_t result() const { return res; }
+    uint8_t rule() const { return tuneRule; }
+    uint8_t cycles() const { return cycleCount; }
+    uint8_t output() const { return out; }
+    int32_t target() const { return targetC; }
+    uint32_t elapsedMs() const { return lastMs - startMs; }
+    int32_t amplitudeCentiC() const { return amplitude; }
+    double ultimateGain() const { return ku; }             // % heat per °C
+    double ultimatePeriodS() const { return puMs / 1000.0; }
+    PIDTunings tunings() const;
+
+private:
+    void finishCycle(uint32_t nowMs);
+
+    uint8_t st = AT_IDLE;
+    uint8_t res = AT_RESULT_NONE;
+    uint8_t tuneRule = AT_RULE_ZN;
+    uint8_t high = 100;
+    uint8_t out = 0;
+    int32_t targetC = 0;
+    uint32_t startMs = 0;
+    uint32_t lastMs = 0;
+
+    // current cycle, from one switch to low to the next
+    bool started = false;             // seen the first switch to low
+    uint32_t downMs = 0;
+    int32_t peakMax = 0;
+    int32_t peakMin = 0;
+
+    uint8_t cycleCount = 0;
+    uint32_t periods[AT_AVG_CYCLES] = {};
+    int32_t amplitudes[AT_AVG_CYCLES] = {};
+    int32_t amplitude = 0;
+    uint32_t puMs = 0;
+    double ku = 0;
+};
+
+void RelayTuner::begin(int32_t targetCentiC, uint8_t relayHigh, uint8_t tuneWith, uint32_t nowMs) {
+    st = AT_RUNNING;
+    res = AT_RESULT_NONE;
+    tuneRule = tuneWith;
+    high = relayHigh;
+    out = high;
+    targetC = targetCentiC;
+    startMs = lastMs = nowMs;
+    started = false;
+    cycleCount = 0;
+    amplitude = 0;
+    puMs = 0;
+    ku = 0;
+}
+
+void RelayTuner::abort(uint8_t why) {
+    if (st != AT_RUNNING) return;
+    st = AT_ABORTED;
+    res = why;
+    out = 0;
+}
+
+uint8_t RelayTuner::step(int32_t centiC, uint32_t nowMs) {
+    if (st != AT_RUNNING) return 0;
+    lastMs = nowMs;
+
+    if (centiC > targetC + AT_MAX_OVERSHOOT_CENTI) { abort(AT_RESULT_OVERSHOOT); return 0; }
+    if (nowMs - startMs > AT_TIMEOUT_MS) { abort(AT_RESULT_TIMEOUT); return 0; }
+
+    if (centiC > peakMax) peakMax = centiC;
+    if (centiC < peakMin) peakMin = centiC;
+
+    if (out && centiC > targetC + AT_HYSTERESIS_CENTI) {
+        out = 0;
+        if (started) finishCycle(nowMs);
+        started = true;
+        downMs = nowMs;
+        peakMax = peakMin = centiC;
+    } else if (!out && centiC < targetC - AT_HYSTERESIS_CENTI) {
+        out = high;
+    }
+    return out;
+}
+
+// One full oscillation done: keep its period and amplitude, stop once the
+// last few agree
+void RelayTuner::finishCycle(uint32_t nowMs) {
+    uint8_t slot = cycleCount % AT_AVG_CYCLES;
+    periods[slot] = nowMs - downMs;
+    amplitudes[slot] = (peakMax - peakMin) / 2;
+    cycleCount++;
+    if (cycleCount < AT_MIN_CYCLES) return;   // includes the approach from cold
+
+    uint32_t pMin = periods[0], pMax = periods[0], pSum = 0;
+    int32_t aMin = amplitudes[0], aMax = amplitudes[0], aSum = 0;
+    for (uint8_t i = 0; i < AT_AVG_CYCLES; i++) {
+        pMin = min(pMin, periods[i]);
+        pMax = max(pMax, periods[i]);
+        pSum += periods[i];
+        aMin = min(aMin, amplitudes[i]);
+        aMax = max(aMax, amplitudes[i]);
+        aSum += amplitudes[i];
+    }
+    bool settled = (pMax - pMin) * 100 <= pSum / AT_AVG_CYCLES * AT_SETTLED_PERCENT &&
+                   (aMax - aMin) * 100 <= aSum / AT_AVG_CYCLES * AT_SETTLED_PERCENT;
+    if (!settled) {
+        if (cycleCount >= AT_MAX_CYCLES) abort(AT_RESULT_UNSETTLED);
+        return;
+    }
+
+    amplitude = aSum / AT_AVG_CYCLES;
+    puMs = pSum / AT_AVG_CYCLES;
+    double a = amplitude / 100.0;
+    double h = AT_HYSTERESIS_CENTI / 100.0;
+    double d = high / 2.0;
+    ku = 4.0 * d / (PI * sqrt(a > h ? a * a - h * h : a * a));
+    st = AT_DONE;
+    res = AT_RESULT_OK;
+    out = 0;
+}
+
+PIDTunings RelayTuner::tunings() const {
+    double pu = ultimatePeriodS();
+    PIDTunings t;
+    if (tuneRule == AT_RULE_TL) {
+        t.kP = ku / 2.2;
+        t.kI = t.kP / (2.2 * pu);
+        t.kD = t.kP * pu / 6.3;
+    } else {
+        t.kP = 0.6 * ku;
+        t.kI = t.kP / (pu / 2.0);
+        t.kD = t.kP * pu / 8.0;
+    }
+    return t;
+}
+
+// -----------------------------------------------------------------------------
+// Control task glue
+// Heat goes out through manualHeatLevel with the PID in MANUAL, so
+// handlePIDControl() keeps the relay output on the roaster. PID;ON or a
+// profile start while tuning hands heat back to the PID and ends the run.
+// -----------------------------------------------------------------------------
+class Autotune {
+public:
+    bool start(double target, uint8_t rule);   // target in CorF units
+    void stop() { if (running()) finish(AT_RESULT_STOPPED); }
+    void service();                             // after the samples are drained
+
+    bool running() const { return tuner.state() == AT_RUNNING; }
+    const RelayTuner& relay() const { return tuner; }
+    const PIDTunings& applied() const { return last; }
+
+private:
+    void finish(uint8_t why);
+
+    RelayTuner tuner;
+    PIDTunings last = {};
+    uint32_t lastSamples = 0;
+    unsigned long lastSampleMs = 0;
+};
+
+Autotune autotune;
+
+bool Autotune::start(double target, uint8_t rule) {
+    int32_t targetCentiC = lround(CorF == 'F' ? (target - 32.0) * 100.0 / 1.8 : target * 100.0);
+    uint8_t high = myPIDConfig.getMaxPower();
+    if (running() || !tempFilter.valid() || high == 0 || targetCentiC <= 0 ||
+        targetCentiC > AT_MAX_TARGET_CENTI) {
+        return false;
+    }
+
+    profileRunner.stop();
+    if (myPID.GetMode() != MANUAL) setPIDMode(false);
+    lastSamples = tempFilter.sampleCount();
+    lastSampleMs = millis();
+    tuner.begin(targetCentiC, high, rule, lastSampleMs);
+    manualHeatLevel = tuner.output();
+    handleHEAT(manualHeatLevel);
+    D_println("Autotune started");
+    return true;
+}
+
+void Autotune::service() {
+    if (!running()) return;
+    if (myPID.GetMode() != MANUAL) { finish(AT_RESULT_STOPPED); return; }   // PID took over
+
+    unsigned long now = millis();
+    if (tempFilter.sampleCount() == lastSamples) {
+        if (now - lastSampleMs > AT_SENSOR_STALE_MS) finish(AT_RESULT_SENSOR);
+        return;
+    }
+    lastSamples = tempFilter.sampleCount();
+    lastSampleMs = now;
+
+    uint8_t heat = tuner.step(tempFilter.filteredCentiC(), now);
+    if (tuner.state() != AT_RUNNING) { finish(tuner.result()); return; }
+    if (heat != manualHeatLevel) {
+        manualHeatLevel = heat;
+        handleHEAT(heat);
+    }
+}
+
+void Autotune::finish(uint8_t why) {
+    if (tuner.state() == AT_RUNNING) tuner.abort(why);
+    manualHeatLevel = 0;
+    handleHEAT(0);
+    if (tuner.result() != AT_RESULT_OK) {
+        D_println("Autotune aborted, heat off");
+        return;
+    }
+
+    // the PID runs on temp, in CorF units
+    last = tuner.tunings();
+    double perUnit = CorF == 'F' ? 1.0 / 1.8 : 1.0;
+    myPIDConfig.setKp(last.kP * perUnit);
+    myPIDConfig.setKi(last.kI * perUnit);
+    myPIDConfig.setKd(last.kD * perUnit);
+    myPIDConfig.apply(myPID);
+    pSetpoint = CorF == 'F' ? tuner.target() * 0.018 + 32.0 : tuner.target() / 100.0;  // PID;ON holds it
+    D_println("Autotune done, tunings applied");
+}
+
+// -----------------------------------------------------------------------------
+// BLE glue (SkiBLE.h only sees this declaration)
+// -----------------------------------------------------------------------------
+size_t autotuneStatus(uint8_t *out) {
+    const RelayTuner &t = autotune.relay();
+    uint32_t s = t.elapsedMs() / 1000;
+    int16_t target = t.target() / 10;
+    uint16_t amp = t.amplitudeCentiC();
+    uint16_t ku = min(t.ultimateGain() * 100.0, 65535.0);
+    uint16_t pu = min(t.ultimatePeriodS() * 10.0, 65535.0);
+    out[0] = t.state();
+    out[1] = t.result();
+    out[2] = t.rule();
+    out[3] = t.cycles();
+    out[4] = t.output();
+    out[5] = s;
+    out[6] = s >> 8;
+    out[7] = (uint16_t)target;
+    out[8] = (uint16_t)target >> 8;
+    out[9] = amp;
+    out[10] = amp >> 8;
+    out[11] = ku;
+    out[12] = ku >> 8;
+    out[13] = pu;
+    out[14] = pu >> 8;
+    return AUTOTUNE_STATUS_BYTES;
+}
@@ -27,9 +27,9 @@
  * Expects commands via the write characteristic.*/
 
 #include <NimBLEDevice.h>
-#include <queue>    // for std::queue
 #include <string>   // for std::string
 #include "SkiPIDConfig.h"
+#include "SkiRing.h"
 
 // -----------------------------------------------------------------------------
 // NimBLE UUIDs for Hibean roaster Control writes and notifies
@@ -46,62 +46,462 @@
 #define PID_SAMPLE_TIME   "6dbf0203-758d-4b5e-bc11-40cfaea42dfe" // iiii (ms)
 #define PID_MAX_POWER     "6dbf0204-758d-4b5e-bc11-40cfaea42dfe" // 0-100 (%)
 
+// -----------------------------------------------------------------------------
+// NimBLE UUIDs for push telemetry (see SkiTelemetry.h for the packet layout)
+// -----------------------------------------------------------------------------
+#define TELEMETRY         "6dbf0301-758d-4b5e-bc11-40cfaea42dfe" // notify packet; write uint16 LE period ms (0 = off)
+
+// -----------------------------------------------------------------------------
+// NimBLE UUIDs for roast profiles (see SkiProfile.h for the upload format)
+// -----------------------------------------------------------------------------
+#define PROFILE           "6dbf0401-758d-4b5e-bc11-40cfaea42dfe" // write upload chunks; read status
+
+// -----------------------------------------------------------------------------
+// NimBLE UUIDs for roast log download (see SkiRecorder.h for the protocol)
+// -----------------------------------------------------------------------------
+#define RECORDER          "6dbf0501-758d-4b5e-bc11-40cfaea42dfe" // write requests; notifies log chunks
+
+// -----------------------------------------------------------------------------
+// NimBLE UUIDs for PID autotune (see SkiAutotune.h for the status layout)
+// -----------------------------------------------------------------------------
+#define AUTOTUNE          "6dbf0601-758d-4b5e-bc11-40cfaea42dfe" // read status
+
+// -----------------------------------------------------------------------------
+// NimBLE UUIDs for diagnostics (see SkiDiag.h for the blob layout)
+// -----------------------------------------------------------------------------
+#define DIAGNOSTICS       "6dbf0701-758d-4b5e-bc11-40cfaea42dfe" // read histograms and counters
+#define LINK_STATUS       "6dbf0702-758d-4b5e-bc11-40cfaea42dfe" // read negotiated MTU and connection parameters
+
+// -----------------------------------------------------------------------------
+// Command ring from the NimBLE host task to loop()
+// -----------------------------------------------------------------------------
+const size_t CMD_SLOT_BYTES = 128; // longest command line we accept
+const size_t CMD_SLOTS      = 16;  // writes that can queue up behind loop()
+typedef SpscRing<CMD_SLOT_BYTES, CMD_SLOTS> CommandRing;
+
 // -----------------------------------------------------------------------------
 // NimBLE Globals
 // -----------------------------------------------------------------------------
 NimBLEServer* pServer = nullptr;
 NimBLECharacteristic* pTxCharacteristic = nullptr;
+NimBLECharacteristic* pTelemetryCharacteristic = nullptr;
+NimBLECharacteristic* pRecorderCharacteristic = nullptr;
 
 bool deviceConnected = false;
 extern String firmWareVersion;
 extern String sketchName;
-extern std::queue<String> messageQueue;
-extern PID myPID;
+extern CommandRing commandRing;
 extern PIDConfig myPIDConfig;
+void setTelemetryPeriod(uint16_t periodMs);
+void wakeControlTask();
+void profileUploadChunk(const uint8_t* data, size_t len);
+size_t profileStatus(uint8_t* out);
+size_t autotuneStatus(uint8_t* out);
+size_t diagnosticsBlob(uint8_t* out);
+void recorderRequest(const uint8_t* data, size_t len, uint16_t mtu, uint16_t connHandle);
+
+// -----------------------------------------------------------------------------
+// Sessions
+// Up to BLE_MAX_SESSIONS centrals at once, e.g. HiBean driving the roast and
+// a shop tablet logging it. The first one to write a command, a PID setting,
+// a profile or the telemetry period while nobody holds the role becomes the
+// controller and keeps it until it disconnects. The rest are observers:
+// their control writes are dropped, everything else (reads, subscribing to
+// telemetry, log downloads) works as usual.
+// Replies go to the controller only; a telemetry packet is built once and
+// goes to every subscriber in one notify.
+// The NimBLE host task writes the table and the other tasks read it, so it
+// sits behind a spinlock. NimBLE calls are made outside it.
+// -----------------------------------------------------------------------------
+#ifdef CONFIG_BT_NIMBLE_MAX_CONNECTIONS
+const uint8_t BLE_MAX_SESSIONS = CONFIG_BT_NIMBLE_MAX_CONNECTIONS;
+#else
+const uint8_t BLE_MAX_SESSIONS = 3;
+#endif
+
+enum SessionRole : uint8_t { ROLE_OBSERVER, ROLE_CONTROLLER };
+enum SessionSub : uint8_t { SUB_REPLIES = 0x01, SUB_TELEMETRY = 0x02, SUB_RECORDER = 0x04 };
+enum LinkMode : uint8_t { LINK_NONE, LINK_IDLE, LINK_ACTIVE };
+
+struct Session {
+    uint16_t handle = BLE_HS_CONN_HANDLE_NONE;
+    uint8_t role = ROLE_OBSERVER;
+    uint8_t subs = 0;             // SessionSub bits
+    uint8_t mode = LINK_NONE;     // connection parameters last asked for
+    uint16_t mtu = 23;
+    uint16_t dataLen = 0;         // asked for, 0 = refused
+    uint16_t interval = 0;        // as the central last set them
+    uint16_t latency = 0;
+    uint16_t timeout = 0;
+    uint32_t paramUpdates = 0;
+    unsigned long connectedMs = 0;
+    unsigned long lastSeenMs = 0;
+
+    bool open() const { return handle != BLE_HS_CONN_HANDLE_NONE; }
+};
+
+class SessionTable {
+public:
+    // --- NimBLE host task ---
+    bool open(NimBLEConnInfo& info);          // false when every slot is taken
+    void close(uint16_t handle);
+    void setMtu(uint16_t handle, uint16_t mtu);
+    void setDataLen(uint16_t handle, uint16_t len);
+    void setParams(NimBLEConnInfo& info);
+    void subscribe(uint16_t handle, uint8_t sub, bool on);
+    void touch(uint16_t handle);
+    bool admitControl(uint16_t handle);       // controller, or free to become it
+
+    // --- Housekeeping task ---
+    void setMode(uint16_t handle, uint8_t mode);
+
+    // --- Any task ---
+    uint8_t count() const { return openCount; }
+    uint16_t controller() const { return controllerHandle; }
+    bool subscribed(uint8_t sub) const;       // anyone
+    bool controllerLive(unsigned long withinMs, bool telemetryOn) const;
+    bool get(uint8_t slot, Session& out) const;
+    uint32_t controlWritesDropped() const { return dropped; }
+
+private:
+    Session* find(uint16_t handle);
+
+    mutable SpinLock lock;
+    Session slots[BLE_MAX_SESSIONS];
+    volatile uint8_t openCount = 0;
+    volatile uint16_t controllerHandle = BLE_HS_CONN_HANDLE_NONE;
+    volatile uint32_t dropped = 0;
+};
+
+Session* SessionTable::find(uint16_t handle) {
+    for (Session& s : slots) if (s.handle == handle) return &s;
+    return nullptr;
+}
+
+bool SessionTable::open(NimBLEConnInfo& info) {
+    SpinGuard guard(lock);
+    Session* s = find(BLE_HS_CONN_HANDLE_NONE);
+    if (!s) return false;
+    *s = Session();
+    s->handle = info.getConnHandle();
+    s->mtu = info.getMTU();
+    s->interval = info.getConnInterval();
+    s->latency = info.getConnLatency();
+    s->timeout = info.getConnTimeout();
+    s->connectedMs = s->lastSeenMs = millis();
+    openCount++;
+    return true;
+}
+
+void SessionTable::close(uint16_t handle) {
+    SpinGuard guard(lock);
+    Session* s = find(handle);
+    if (!s) return;
+    if (controllerHandle == handle) controllerHandle = BLE_HS_CONN_HANDLE_NONE;
+    *s = Session();
+    openCount--;
+}
+
+void SessionTable::setMtu(uint16_t handle, uint16_t mtu) {
+    SpinGuard guard(lock);
+    if (Session* s = find(handle)) s->mtu = mtu;
+}
+
+void SessionTable::setDataLen(uint16_t handle, uint16_t len) {
+    SpinGuard guard(lock);
+    if (Session* s = find(handle)) s->dataLen = len;
+}
+
+void SessionTable::setParams(NimBLEConnInfo& info) {
+    SpinGuard guard(lock);
+    if (Session* s = find(info.getConnHandle())) {
+        s->interval = info.getConnInterval();
+        s->latency = info.getConnLatency();
+        s->timeout = info.getConnTimeout();
+        s->paramUpdates++;
+    }
+}
+
+void SessionTable::subscribe(uint16_t handle, uint8_t sub, bool on) {
+    SpinGuard guard(lock);
+    if (Session* s = find(handle)) {
+        s->subs = on ? s->subs | sub : s->subs & ~sub;
+        s->lastSeenMs = millis();
+    }
+}
+
+void SessionTable::touch(uint16_t handle) {
+    SpinGuard guard(lock);
+    if (Session* s = find(handle)) s->lastSeenMs = millis();
+}
+
+bool SessionTable::admitControl(uint16_t handle) {
+    SpinGuard guard(lock);
+    Session* s = find(handle);
+    if (s && controllerHandle == BLE_HS_CONN_HANDLE_NONE) {
+        s->role = ROLE_CONTROLLER;
+        controllerHandle = handle;
+    }
+    if (!s || controllerHandle != handle) { dropped++; return false; }
+    s->lastSeenMs = millis();
+    return true;
+}
+
+void SessionTable::setMode(uint16_t handle, uint8_t mode) {
+    SpinGuard guard(lock);
+    if (Session* s = find(handle)) s->mode = mode;
+}
+
+bool SessionTable::subscribed(uint8_t sub) const {
+    SpinGuard guard(lock);
+    for (const Session& s : slots) if (s.open() && (s.subs & sub)) return true;
+    return false;
+}
+
+// The controller wrote or subscribed within withinMs, or takes telemetry
+// while it is on: a central that stopped listening drops the connection
+bool SessionTable::controllerLive(unsigned long withinMs, bool telemetryOn) const {
+    SpinGuard guard(lock);
+    for (const Session& s : slots) {
+        if (!s.open() || s.handle != controllerHandle) continue;
+        if (telemetryOn && (s.subs & SUB_TELEMETRY)) return true;
+        return millis() - s.lastSeenMs <= withinMs;
+    }
+    return false;
+}
+
+bool SessionTable::get(uint8_t slot, Session& out) const {
+    SpinGuard guard(lock);
+    out = slots[slot];
+    return out.open();
+}
+
+SessionTable sessions;
+
+// -----------------------------------------------------------------------------
+// Link manager
+// At connect: ask for a big ATT MTU and data length extension, so a reply or
+// telemetry packet goes out in one notify and one link layer packet instead
+// of being cut at 20 bytes. Then keep the connection interval short with no
+// slave latency while the roaster is working (heat or drum on) and relax it,
+// with latency, once it has been idle for LINK_IDLE_HOLD_MS, to cut radio
+// duty between roasts. Only the controller follows the roast: observers get
+// the relaxed set once they are LINK_IDLE_HOLD_MS past discovery. Both sets
+// follow Apple's accessory guidelines (min >= 15 ms, max >= min + 15 ms,
+// timeout 2-6 s):
+// https://docs.silabs.com/bluetooth/4.0/bluetooth-miscellaneous-mobile/selecting-suitaNimBLE-connection-parameters-for-apple-devices
+//
+// The central has the last word; what each one settled on is reported by LINK
+// and by reading the LINK_STATUS characteristic, little-endian:
+//   uint8 version, uint8 sessions, uint16 controller handle (0xFFFF = none),
+//   uint32 parameter requests, then per session:
+//   uint16 handle, uint8 role (SessionRole), uint8 mode (LinkMode),
+//   uint8 subscriptions (SessionSub), uint8 0, uint16 ATT MTU,
+//   uint16 data length asked for (0 = refused), uint16 interval (1.25 ms),
+//   uint16 latency, uint16 timeout (10 ms), uint32 parameter updates,
+//   uint32 ms since last seen
+// -----------------------------------------------------------------------------
+const uint8_t LINK_VERSION = 2;
+const size_t LINK_SESSION_BYTES = 24;
+const size_t LINK_BLOB_BYTES = 8 + BLE_MAX_SESSIONS * LINK_SESSION_BYTES;
+const uint16_t LINK_MTU = 247;              // 251 byte LL payload less the L2CAP header
+const uint16_t LINK_DATA_LEN = 251;         // max LL payload with DLE
+const unsigned long LINK_IDLE_HOLD_MS = 30000;
+
+struct LinkParams {
+    uint16_t minInterval;   // 1.25 ms units
+    uint16_t maxInterval;
+    uint16_t latency;       // connection events the peripheral may skip
+    uint16_t timeout;       // 10 ms units
+};
+
+const LinkParams LINK_ACTIVE_PARAMS = { 12, 24, 0, 400 };   // 15-30 ms, every event, 4 s
+const LinkParams LINK_IDLE_PARAMS   = { 48, 96, 4, 600 };   // 60-120 ms, skip 4, 6 s
+
+class LinkManager {
+public:
+    void begin() { NimBLEDevice::setMTU(LINK_MTU); }
+
+    // NimBLE host task, after sessions.open()
+    void connected(NimBLEServer* server, NimBLEConnInfo& info);
+
+    // Housekeeping task: active = heat or drum on
+    void service(bool active);
+
+    size_t status(uint8_t* out) const;
+    int format(char* buf, size_t len) const;
+
+private:
+    void request(uint16_t handle, LinkMode m);
+
+    NimBLEServer* server = nullptr;
+    volatile uint32_t requests = 0;
+    bool everActive = false;
+    unsigned long lastActiveMs = 0;
+};
+
+void LinkManager::connected(NimBLEServer* srv, NimBLEConnInfo& info) {
+    server = srv;
+    uint16_t handle = info.getConnHandle();
+    sessions.setDataLen(handle, server->setDataLen(handle, LINK_DATA_LEN) ? LINK_DATA_LEN : 0);
+    ble_gattc_exchange_mtu(handle, nullptr, nullptr);   // iOS asks on its own, Android often doesn't
+    // discovery and the first commands go fast, service() relaxes it later
+    request(handle, LINK_ACTIVE);
+}
+
+void LinkManager::service(bool active) {
+    unsigned long now = millis();
+    if (active) { lastActiveMs = now; everActive = true; }
+    bool busy = everActive && now - lastActiveMs < LINK_IDLE_HOLD_MS;
+
+    for (uint8_t i = 0; i < BLE_MAX_SESSIONS; i++) {
+        Session s;
+        if (!sessions.get(i, s)) continue;
+        bool discovering = now - s.connectedMs < LINK_IDLE_HOLD_MS;
+        LinkMode want = discovering || (s.role == ROLE_CONTROLLER && busy) ? LINK_ACTIVE : LINK_IDLE;
+        if (s.mode != want) request(s.handle, want);
+    }
+}
+
+void LinkManager::request(uint16_t handle, LinkMode m) {
+    const LinkParams& p = m == LINK_ACTIVE ? LINK_ACTIVE_PARAMS : LINK_IDLE_PARAMS;
+    sessions.setMode(handle, m);
+    server->updateConnParams(handle, p.minInterval, p.maxInterval, p.latency, p.timeout);
+    requests++;
+    D_print("BLE: link "); D_println(m == LINK_ACTIVE ? "active" : "idle");
+}
+
+size_t LinkManager::status(uint8_t* out) const {
+    uint8_t* p = out + 8;
+    uint8_t n = 0;
+    unsigned long now = millis();
+    for (uint8_t i = 0; i < BLE_MAX_SESSIONS; i++) {
+        Session s;
+        if (!sessions.get(i, s)) continue;
+        uint16_t half[5] = { s.mtu, s.dataLen, s.interval, s.latency, s.timeout };
+        uint32_t word[2] = { s.paramUpdates, (uint32_t)(now - s.lastSeenMs) };
+        *p++ = s.handle & 0xFF; *p++ = s.handle >> 8;
+        *p++ = s.role;
+        *p++ = s.mode;
+        *p++ = s.subs;
+        *p++ = 0;
+        for (uint16_t v : half) { *p++ = v & 0xFF; *p++ = v >> 8; }
+        for (uint32_t v : word) { for (int b = 0; b < 4; b++) *p++ = v >> (8 * b); }
+        n++;
+    }
+    uint16_t ctl = sessions.controller();
+    uint32_t req = requests;
+    out[0] = LINK_VERSION;
+    out[1] = n;
+    out[2] = ctl & 0xFF; out[3] = ctl >> 8;
+    for (int b = 0; b < 4; b++) out[4 + b] = req >> (8 * b);
+    return p - out;
+}
+
+// "# LINK 1:CTL ACTIVE 247/251 30.00ms/0 s=RT 2:OBS IDLE 185/251 120.00ms/4 s=T"
+// per session: handle:role mode MTU/data length interval/latency subscriptions
+int LinkManager::format(char* buf, size_t len) const {
+    static const char* const modes[] = { "NONE", "IDLE", "ACTIVE" };
+    int n = snprintf(buf, len, "# LINK");
+    for (uint8_t i = 0; i < BLE_MAX_SESSIONS && n > 0 && (size_t)n < len; i++) {
+        Session s;
+        if (!sessions.get(i, s)) continue;
+        char subs[4] = {}, *q = subs;
+        if (s.subs & SUB_REPLIES) *q++ = 'R';
+        if (s.subs & SUB_TELEMETRY) *q++ = 'T';
+        if (s.subs & SUB_RECORDER) *q++ = 'L';
+        n += snprintf(buf + n, len - n, " %u:%s %s %u/%u %.2fms/%u s=%s", s.handle,
+                      s.role == ROLE_CONTROLLER ? "CTL" : "OBS", modes[s.mode], s.mtu, s.dataLen,
+                      s.interval * 1.25, s.latency, subs);
+    }
+    if (n > 0 && (size_t)n < len - 1) { buf[n++] = '\n'; buf[n] = '\0'; }
+    return n < (int)len ? n : (int)len - 1;
+}
+
+LinkManager linkManager;
 
 // -----------------------------------------------------------------------------
 // NimBLE Server Callbacks
 // -----------------------------------------------------------------------------
 class MyServerCallbacks : public NimBLEServerCallbacks {
   void onConnect(NimBLEServer* pServer, NimBLEConnInfo& connInfo) override {
+    if (!sessions.open(connInfo)) {
+      D_println("BLE: no free session, disconnecting.");
+      pServer->disconnect(connInfo.getConnHandle());
+      return;
+    }
     deviceConnected = true;
-
-    // Change NimBLE connection parameters per apple NimBLE guidelines
-    // (for this client, min interval 15ms (/1.25), max 30ms (/1.25), latency 4 frames, timeout 5sec(/10ms)
-    // https://docs.silabs.com/bluetooth/4.0/bluetooth-miscellaneous-mobile/selecting-suitaNimBLE-connection-parameters-for-apple-devices
-    pServer->updateConnParams(connInfo.getConnHandle(), 12, 24, 4, 500);
-   
+    linkManager.connected(pServer, connInfo);
     D_println("BLE: Client connected.");
+
+    // keep advertising while there is room for another central
+    if (sessions.count() < BLE_MAX_SESSIONS) pServer->getAdvertising()->start();
   }
-  void onDisconnect(NimBLEServer* pServer, NimBLEConnInfo& connInfo, int reason) override {
-    deviceConnected = false;
+  void onDisconnect(NimBLEServer* pServer, NimBLEConnInfo& connInfo, int /*reason*/) override {
+    sessions.close(connInfo.getConnHandle());
+    deviceConnected = sessions.count() > 0;
     D_println("BLE: Client disconnected. Restarting advertising...");
     pServer->getAdvertising()->start();
   }
+  void onMTUChange(uint16_t mtu, NimBLEConnInfo& connInfo) override {
+    sessions.setMtu(connInfo.getConnHandle(), mtu);
+  }
+  void onConnParamsUpdate(NimBLEConnInfo& connInfo) override {
+    sessions.setParams(connInfo);
+  }
 };
 
 // -----------------------------------------------------------------------------
 // NimBLE Characteristic Callbacks
 // -----------------------------------------------------------------------------
+
+// Notify characteristics track who subscribed, per session
+class SubscribeCallback : public NimBLECharacteristicCallbacks {
+public:
+  explicit SubscribeCallback(uint8_t sub) : sub(sub) {}
+  void onSubscribe(NimBLECharacteristic* /*pCharacteristic*/, NimBLEConnInfo& connInfo, uint16_t subValue) override {
+    sessions.subscribe(connInfo.getConnHandle(), sub, subValue != 0);
+  }
+private:
+  uint8_t sub;
+};
+
+// Writes that change the roast only count from the controller
+bool controlWriteAllowed(NimBLEConnInfo& connInfo) {
+  if (sessions.admitControl(connInfo.getConnHandle())) return true;
+  D_println("BLE: control write from an observer dropped");
+  return false;
+}
+
 class RoasterCallbacks : public NimBLECharacteristicCallbacks {
   void onWrite(NimBLECharacteristic* pCharacteristic, NimBLEConnInfo& connInfo) override {
-    String rxValue = String(pCharacteristic->getValue().c_str());
-    rxValue.remove(rxValue.lastIndexOf("\n")); //remove trailing newlines
+    if (!controlWriteAllowed(connInfo)) return;
+    NimBLEAttValue rxValue = pCharacteristic->getValue();
+    const char* data = (const char*)rxValue.data();
+    size_t len = rxValue.length();
 
-    if (rxValue.length() > 0) {
-      String input = String(rxValue.c_str());
-      D_print("BLE Write Received: ");  D_println(input);
-      messageQueue.push(rxValue);    }
+    // drop the trailing newline(s); any before that separate a command batch
+    while (len > 0 && (data[len - 1] == '\n' || data[len - 1] == '\r')) len--;
+
+    if (len > 0) {
+      D_print("BLE Write Received: ");  D_println(rxValue.c_str());
+      if (commandRing.push(data, len, micros())) {
+        wakeControlTask();
+      } else {
+        D_println("BLE: command ring full, write dropped");
+      }
+    }
   }
 };
 
 class PIDTuneCallback : public NimBLECharacteristicCallbacks {
   void onWrite(NimBLECharacteristic* pCharacteristic, NimBLEConnInfo& connInfo) override {
+    if (!controlWriteAllowed(connInfo)) return;
     String rxValue = String(pCharacteristic->getValue().c_str());
     
-    double pidTune[3]; //pp.p;ii.i;dd.d
+    double pidTune[3] = { myPIDConfig.getKp(), myPIDConfig.getKi(), myPIDConfig.getKd() }; //pp.p;ii.i;dd.d
     int paramCount = 0;
-    while(rxValue.length() > 0) {
+    while(rxValue.length() > 0 && paramCount < 3) {
         int index = rxValue.indexOf(',');
         if (index == -1) { // No delim found
             pidTune[paramCount++] = rxValue.toDouble(); //remaining string
@@ -112,9 +512,9 @@ class PIDTuneCallback : public NimBLECharacteristicCallbacks {
         }
       }
     myPIDConfig.setKp(pidTune[0]); myPIDConfig.setKi(pidTune[1]); myPIDConfig.setKd(pidTune[2]);
-    myPIDConfig.apply(myPID);
+    wakeControlTask();  // it applies the staged values
   }
-  void onRead(NimBLECharacteristic* pCharacteristic, NimBLEConnInfo& connInfo) override {
+  void onRead(NimBLECharacteristic* pCharacteristic, NimBLEConnInfo& /*connInfo*/) override {
       D_println("PIDTuneRead Received.");
       pCharacteristic->setValue(String(myPIDConfig.getKp()) + ',' + String(myPIDConfig.getKi()) + ',' + String(myPIDConfig.getKd()));
   }
@@ -122,6 +522,7 @@ class PIDTuneCallback : public NimBLECharacteristicCallbacks {
 
 class PIDModeCallback : public NimBLECharacteristicCallbacks {
   void onWrite(NimBLECharacteristic* pCharacteristic, NimBLEConnInfo& connInfo) override {
+    if (!controlWriteAllowed(connInfo)) return;
     String rxValue = String(pCharacteristic->getValue().c_str());
     
     if(rxValue == "P_ON_E") {
@@ -129,9 +530,9 @@ class PIDModeCallback : public NimBLECharacteristicCallbacks {
     } else {
       myPIDConfig.setPMode(P_ON_M);
     }
-    myPIDConfig.apply(myPID);
+    wakeControlTask();  // it applies the staged values
   }
-  void onRead(NimBLECharacteristic* pCharacteristic, NimBLEConnInfo& connInfo) override {
+  void onRead(NimBLECharacteristic* pCharacteristic, NimBLEConnInfo& /*connInfo*/) override {
       D_println("PMode Received.");
       if (myPIDConfig.getPMode() == P_ON_E) {
         pCharacteristic->setValue("P_ON_E");
@@ -143,11 +544,12 @@ class PIDModeCallback : public NimBLECharacteristicCallbacks {
 
 class PIDSampleTimeCallback : public NimBLECharacteristicCallbacks {
   void onWrite(NimBLECharacteristic* pCharacteristic, NimBLEConnInfo& connInfo) override {
+    if (!controlWriteAllowed(connInfo)) return;
     String rxValue = String(pCharacteristic->getValue().c_str()); 
     myPIDConfig.setSampleTime(rxValue.toInt());
-    myPIDConfig.apply(myPID);
+    wakeControlTask();  // it applies the staged values
   }
-  void onRead(NimBLECharacteristic* pCharacteristic, NimBLEConnInfo& connInfo) override {
+  void onRead(NimBLECharacteristic* pCharacteristic, NimBLEConnInfo& /*connInfo*/) override {
       D_println("SampleTime Received.");
       pCharacteristic->setValue(String(myPIDConfig.getSampleTime()));
   }
@@ -155,33 +557,191 @@ class PIDSampleTimeCallback : public NimBLECharacteristicCallbacks {
 
 class PIDMaxPowerCallback : public NimBLECharacteristicCallbacks {
   void onWrite(NimBLECharacteristic* pCharacteristic, NimBLEConnInfo& connInfo) override {
+    if (!controlWriteAllowed(connInfo)) return;
     String rxValue = String(pCharacteristic->getValue().c_str()); 
     myPIDConfig.setMaxPower(rxValue.toInt());
-    myPIDConfig.apply(myPID);
+    wakeControlTask();  // it applies the staged values
   }
-  void onRead(NimBLECharacteristic* pCharacteristic, NimBLEConnInfo& connInfo) override {
+  void onRead(NimBLECharacteristic* pCharacteristic, NimBLEConnInfo& /*connInfo*/) override {
       D_println("MaxPower Received.");
       pCharacteristic->setValue(String(myPIDConfig.getMaxPower()));
   }
 };
 
-// HiBean notify response to write()
-void notifyNimBLEClient(const String& message) {
-    D_println("Attempting to notify NimBLE client with: " + message);
-    delay(30); //Give up time so hibean sees delta between write and notify timestamps
+// -----------------------------------------------------------------------------
+// Outbound notifications
+// HiBean needs a delta between the write and notify timestamps. Rather than
+// sleeping, each reply is queued with the time of the write it answers and
+// the BLE transport sends it from the control task once NOTIFY_SPACING_US has
+// passed. If the client falls behind, an unsent READ reply is replaced by the
+// fresh one instead of queueing stale temperatures.
+// -----------------------------------------------------------------------------
+const size_t NOTIFY_SLOT_BYTES          = 128;
+const size_t NOTIFY_SLOTS               = 8;
+const unsigned long NOTIFY_SPACING_US   = 30000UL;
+
+enum NotifyKind { NOTIFY_REPLY, NOTIFY_READ };
 
-    if (deviceConnected && pTxCharacteristic) {
-        pTxCharacteristic->setValue(message.c_str());
-        pTxCharacteristic->notify();
-       D_println("Notification sent successfully.");
-    } else {
-      D_println("Notification failed. Device not connected or TX characteristic unavailable.");
+uint32_t commandWriteUs = 0; // arrival time of the command being executed
+
+class NotifyQueue {
+public:
+    bool push(const char* msg, size_t len, NotifyKind kind, uint32_t writeUs);
+    void service();
+    void clear() { count = 0; }
+    size_t depth() const { return count; }
+    size_t maxDepth = 0;       // since the last diagnostics reset
+
+    // --- Stats ---
+    uint32_t sent = 0;
+    uint32_t merged = 0;       // stale READ replies overwritten
+    uint32_t dropped = 0;      // queue full or client gone
+    uint32_t lastLatencyUs = 0;
+    uint32_t maxLatencyUs = 0; // write -> notify
+    uint64_t sumLatencyUs = 0;
+
+private:
+    struct Entry {
+        uint32_t writeUs;
+        uint8_t kind;
+        uint16_t len;
+        char data[NOTIFY_SLOT_BYTES];
+    };
+    Entry entries[NOTIFY_SLOTS];
+    size_t first = 0;
+    size_t count = 0;
+
+    Entry& at(size_t i) { return entries[(first + i) % NOTIFY_SLOTS]; }
+};
+
+bool NotifyQueue::push(const char* msg, size_t len, NotifyKind kind, uint32_t writeUs) {
+    if (len > NOTIFY_SLOT_BYTES) len = NOTIFY_SLOT_BYTES;
+
+    Entry* e = nullptr;
+    if (kind == NOTIFY_READ) {
+        for (size_t i = 0; i < count && !e; i++) {
+            if (at(i).kind == NOTIFY_READ) { e = &at(i); merged++; } // keep its place and due time
+        }
+    }
+    if (!e && count == NOTIFY_SLOTS) {
+        // full: the oldest READ reply is the least useful thing we're holding
+        size_t victim = NOTIFY_SLOTS;
+        for (size_t i = 0; i < count && victim == NOTIFY_SLOTS; i++) {
+            if (at(i).kind == NOTIFY_READ) victim = i;
+        }
+        dropped++;
+        if (victim == NOTIFY_SLOTS) return false;
+        for (size_t i = victim; i + 1 < count; i++) at(i) = at(i + 1);
+        count--;
     }
+    if (!e) {
+        e = &at(count++);
+        if (count > maxDepth) maxDepth = count;
+        e->writeUs = writeUs;
+        e->kind = kind;
+    }
+    memcpy(e->data, msg, len);
+    e->len = len;
+    return true;
+}
+
+void NotifyQueue::service() {
+    if (count == 0) return;
+    uint16_t to = sessions.controller();   // replies answer the controller's commands
+    if (to == BLE_HS_CONN_HANDLE_NONE || !pTxCharacteristic) {
+        D_println("Notification failed. Controller not connected or TX characteristic unavailable.");
+        dropped += count;
+        count = 0;
+        return;
+    }
+
+    uint32_t now = micros();
+    while (count > 0 && now - at(0).writeUs >= NOTIFY_SPACING_US) {
+        Entry& e = at(0);
+        pTxCharacteristic->setValue((const uint8_t*)e.data, e.len);
+        pTxCharacteristic->notify(to);
+
+        lastLatencyUs = now - e.writeUs;
+        if (lastLatencyUs > maxLatencyUs) maxLatencyUs = lastLatencyUs;
+        sumLatencyUs += lastLatencyUs;
+        diag.record(DIAG_NOTIFY_LATENCY, lastLatencyUs);
+        sent++;
+
+        first = (first + 1) % NOTIFY_SLOTS;
+        count--;
+    }
+}
+
+NotifyQueue notifyQueue;
+
+class TelemetryCallback : public SubscribeCallback {
+public:
+  TelemetryCallback() : SubscribeCallback(SUB_TELEMETRY) {}
+  // one period for every subscriber, so only the controller sets it
+  void onWrite(NimBLECharacteristic* pCharacteristic, NimBLEConnInfo& connInfo) override {
+    if (!controlWriteAllowed(connInfo)) return;
+    NimBLEAttValue rxValue = pCharacteristic->getValue();
+    if (rxValue.length() >= 2) {
+      setTelemetryPeriod(rxValue.data()[0] | (rxValue.data()[1] << 8));
+    }
+  }
+};
+
+class ProfileCallback : public NimBLECharacteristicCallbacks {
+  void onWrite(NimBLECharacteristic* pCharacteristic, NimBLEConnInfo& connInfo) override {
+    if (!controlWriteAllowed(connInfo)) return;
+    NimBLEAttValue rxValue = pCharacteristic->getValue();
+    profileUploadChunk(rxValue.data(), rxValue.length());
+  }
+  void onRead(NimBLECharacteristic* pCharacteristic, NimBLEConnInfo& /*connInfo*/) override {
+    uint8_t status[8];
+    pCharacteristic->setValue(status, profileStatus(status));
+  }
+};
+
+class AutotuneCallback : public NimBLECharacteristicCallbacks {
+  void onRead(NimBLECharacteristic* pCharacteristic, NimBLEConnInfo& /*connInfo*/) override {
+    uint8_t status[16];
+    pCharacteristic->setValue(status, autotuneStatus(status));
+  }
+};
+
+class DiagnosticsCallback : public NimBLECharacteristicCallbacks {
+  void onRead(NimBLECharacteristic* pCharacteristic, NimBLEConnInfo& /*connInfo*/) override {
+    uint8_t blob[DIAG_BLOB_BYTES];
+    pCharacteristic->setValue(blob, diagnosticsBlob(blob));
+  }
+};
+
+class LinkStatusCallback : public NimBLECharacteristicCallbacks {
+  void onRead(NimBLECharacteristic* pCharacteristic, NimBLEConnInfo& /*connInfo*/) override {
+    uint8_t blob[LINK_BLOB_BYTES];
+    pCharacteristic->setValue(blob, linkManager.status(blob));
+  }
+};
+
+class RecorderCallback : public SubscribeCallback {
+public:
+  RecorderCallback() : SubscribeCallback(SUB_RECORDER) {}
+  void onWrite(NimBLECharacteristic* pCharacteristic, NimBLEConnInfo& connInfo) override {
+    sessions.touch(connInfo.getConnHandle());
+    NimBLEAttValue rxValue = pCharacteristic->getValue();
+    recorderRequest(rxValue.data(), rxValue.length(), connInfo.getMTU(), connInfo.getConnHandle());
+  }
+};
+
+// HiBean notify response to write(), see SkiTransport.h for the reply path
+bool notifyNimBLEClient(const char* message, size_t len, NotifyKind kind = NOTIFY_REPLY) {
+    D_print("Queueing notify to NimBLE client: "); D_println(message);
+    if (notifyQueue.push(message, len, kind, commandWriteUs)) return true;
+    D_println("Notification dropped, queue full.");
+    return false;
 }
 
 void extern initBLE() {
     std::string NimBLEDeviceName = "ESP32_Skycommand_BLE";
     NimBLEDevice::init(NimBLEDeviceName);
+    linkManager.begin();
 
     pServer = NimBLEDevice::createServer();
     pServer->setCallbacks(new MyServerCallbacks());
@@ -192,6 +752,7 @@ void extern initBLE() {
     pTxCharacteristic = pService->createCharacteristic(
         CHARACTERISTIC_UUID_TX, NIMBLE_PROPERTY::NOTIFY | NIMBLE_PROPERTY::READ
     );
+    pTxCharacteristic->setCallbacks(new SubscribeCallback(SUB_REPLIES));
 
     // Hibean commands to Roaster
     NimBLECharacteristic* pRxCharacteristic = pService->createCharacteristic(
@@ -235,6 +796,60 @@ void extern initBLE() {
     pidMaxPowerDescriptor->setValue("PID Max Power: 0-100 (%)");
     pidMaxPowerCharacteristic->addDescriptor(pidMaxPowerDescriptor);
 
+    // TELEMETRY stream
+    pTelemetryCharacteristic = pService->createCharacteristic(
+        TELEMETRY, NIMBLE_PROPERTY::READ | NIMBLE_PROPERTY::WRITE | NIMBLE_PROPERTY::NOTIFY
+    );
+    pTelemetryCharacteristic->setCallbacks(new TelemetryCallback());
+    NimBLEDescriptor* telemetryDescriptor = pTelemetryCharacteristic->createDescriptor(TELEMETRY, NIMBLE_PROPERTY::READ);
+    telemetryDescriptor->setValue("Telemetry: write uint16 period ms, notifies packed LE sample");
+    pTelemetryCharacteristic->addDescriptor(telemetryDescriptor);
+
+    // PROFILE upload and status
+    NimBLECharacteristic* profileCharacteristic = pService->createCharacteristic(
+        PROFILE, NIMBLE_PROPERTY::READ | NIMBLE_PROPERTY::WRITE
+    );
+    profileCharacteristic->setCallbacks(new ProfileCallback());
+    NimBLEDescriptor* profileDescriptor = profileCharacteristic->createDescriptor(PROFILE, NIMBLE_PROPERTY::READ);
+    profileDescriptor->setValue("Profile: write begin/points/commit chunks, read status");
+    profileCharacteristic->addDescriptor(profileDescriptor);
+
+    // AUTOTUNE status
+    NimBLECharacteristic* autotuneCharacteristic = pService->createCharacteristic(
+        AUTOTUNE, NIMBLE_PROPERTY::READ
+    );
+    autotuneCharacteristic->setCallbacks(new AutotuneCallback());
+    NimBLEDescriptor* autotuneDescriptor = autotuneCharacteristic->createDescriptor(AUTOTUNE, NIMBLE_PROPERTY::READ);
+    autotuneDescriptor->setValue("Autotune: read relay state, cycles, Ku, Pu");
+    autotuneCharacteristic->addDescriptor(autotuneDescriptor);
+
+    // DIAGNOSTICS histograms and counters
+    NimBLECharacteristic* diagCharacteristic = pService->createCharacteristic(
+        DIAGNOSTICS, NIMBLE_PROPERTY::READ
+    );
+    diagCharacteristic->setCallbacks(new DiagnosticsCallback());
+    NimBLEDescriptor* diagDescriptor = diagCharacteristic->createDescriptor(DIAGNOSTICS, NIMBLE_PROPERTY::READ);
+    diagDescriptor->setValue("Diagnostics: read latency histograms and counters, DIAG;RESET clears");
+    diagCharacteristic->addDescriptor(diagDescriptor);
+
+    // LINK_STATUS negotiated MTU and connection parameters
+    NimBLECharacteristic* linkCharacteristic = pService->createCharacteristic(
+        LINK_STATUS, NIMBLE_PROPERTY::READ
+    );
+    linkCharacteristic->setCallbacks(new LinkStatusCallback());
+    NimBLEDescriptor* linkDescriptor = linkCharacteristic->createDescriptor(LINK_STATUS, NIMBLE_PROPERTY::READ);
+    linkDescriptor->setValue("Link: read MTU, data length, interval, latency, timeout, mode");
+    linkCharacteristic->addDescriptor(linkDescriptor);
+
+    // RECORDER log download
+    pRecorderCharacteristic = pService->createCharacteristic(
+        RECORDER, NIMBLE_PROPERTY::WRITE | NIMBLE_PROPERTY::WRITE_NR | NIMBLE_PROPERTY::NOTIFY
+    );
+    pRecorderCharacteristic->setCallbacks(new RecorderCallback());
+    NimBLEDescriptor* recorderDescriptor = pRecorderCharacteristic->createDescriptor(RECORDER, NIMBLE_PROPERTY::READ);
+    recorderDescriptor->setValue("Recorder: write list/get/credit/stop, notifies log chunks");
+    pRecorderCharacteristic->addDescriptor(recorderDescriptor);
+
     pService->start();
 
     // esp32 information to HiBean for support/debug purposes
@@ -0,0 +1,202 @@
+/*
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+// -----------------------------------------------------------------------------
+// Hot path benchmarks
+// Each case runs a warm-up, then times every call on its own and reports the
+// min, median, p99 and max as one JSON object per line, e.g.
+//   {"bench":"rx_validate","target":"esp32c6","fw":"v1.2.2","unit":"cycles",
+//    "mhz":160,"iters":1000,"min":41,"median":41,"p99":44,"max":212}
+// so runs from two releases can be diffed line by line. The cost of reading
+// the counter is measured first and taken off every figure.
+//
+// On the device (-D SKI_BENCH=1, see the *-bench envs in platformio.ini) the
+// firmware is initialised but its tasks never start: loop() runs the suite
+// and prints it over USB CDC every BENCH_REPEAT_MS, in CPU cycles. No frames
+// go to the roaster. On the host bench/ runs the same suite against the shims,
+// in TSC ticks (or ns off x86).
+// -----------------------------------------------------------------------------
+
+#include <algorithm>
+#if defined(SKI_NATIVE)
+#include <chrono>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+#endif
+
+extern SkyRoasterParser roaster;
+extern PIDConfig myPIDConfig;
+extern String firmWareVersion;
+
+const uint16_t BENCH_WARMUP     = 50;
+const uint16_t BENCH_ITERS      = 1000;
+const uint16_t BENCH_ITERS_MAX  = 2000;
+const uint32_t BENCH_REPEAT_MS  = 10000;
+
+// -----------------------------------------------------------------------------
+// Counter
+// -----------------------------------------------------------------------------
+#if !defined(SKI_NATIVE)
+inline uint32_t benchCounter() { return ESP.getCycleCount(); }
+inline uint32_t benchMhz() { return getCpuFrequencyMhz(); }
+const char *const BENCH_UNIT = "cycles";
+const char *const BENCH_TARGET = CONFIG_IDF_TARGET;
+#elif defined(__x86_64__) || defined(__i386__)
+inline uint32_t benchCounter() { return (uint32_t)__rdtsc(); }
+inline uint32_t benchMhz() { return 0; }   // TSC rate, not worth guessing
+const char *const BENCH_UNIT = "tsc";
+const char *const BENCH_TARGET = "host";
+#else
+inline uint32_t benchCounter() {
+    return (uint32_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+inline uint32_t benchMhz() { return 0; }
+const char *const BENCH_UNIT = "ns";
+const char *const BENCH_TARGET = "host";
+#endif
+
+// results land here so the compiler can't drop the calls
+volatile uint32_t benchSink = 0;
+
+// -----------------------------------------------------------------------------
+// Runner
+// -----------------------------------------------------------------------------
+class BenchRunner {
+public:
+    void setIters(uint16_t n) { iters = std::min(std::max(n, (uint16_t)1), BENCH_ITERS_MAX); }
+
+    // prep runs untimed before every call, e.g. to move the clock on
+    template <typename Prep, typename Fn>
+    void run(const char *name, Prep prep, Fn fn) {
+        for (uint16_t i = 0; i < BENCH_WARMUP; i++) { prep(); fn(); }
+        for (uint16_t i = 0; i < iters; i++) {
+            prep();
+            uint32_t start = benchCounter();
+            fn();
+            uint32_t took = benchCounter() - start;
+            samples[i] = took > overhead ? took - overhead : 0;
+        }
+        report(name);
+    }
+
+    template <typename Fn>
+    void run(const char *name, Fn fn) { run(name, [] {}, fn); }
+
+    // back-to-back counter reads, the floor under every figure
+    void calibrate() {
+        overhead = 0;
+        run("overhead", [] {});
+        overhead = samples[0];   // min, after the sort in report()
+    }
+
+private:
+    void report(const char *name);
+
+    uint16_t iters = BENCH_ITERS;
+    uint32_t overhead = 0;
+    uint32_t samples[BENCH_ITERS_MAX];
+};
+
+void BenchRunner::report(const char *name) {
+    std::sort(samples, samples + iters);
+    uint16_t p99 = (uint32_t)iters * 99 / 100;
+    char line[200];
+    snprintf(line, sizeof(line),
+             "{\"bench\":\"%s\",\"target\":\"%s\",\"fw\":\"%s\",\"unit\":\"%s\",\"mhz\":%u,\"iters\":%u,"
+             "\"min\":%lu,\"median\":%lu,\"p99\":%lu,\"max\":%lu}",
+             name, BENCH_TARGET, firmWareVersion.c_str(), BENCH_UNIT, (unsigned)benchMhz(), iters,
+             (unsigned long)samples[0], (unsigned long)samples[iters / 2],
+             (unsigned long)samples[p99 < iters ? p99 : iters - 1], (unsigned long)samples[iters - 1]);
+    Serial.println(line);
+}
+
+// -----------------------------------------------------------------------------
+// Cases
+// -----------------------------------------------------------------------------
+
+// A bean temp frame around 200 C (X range, raw 390) with its checksum
+const uint8_t BENCH_RX_FRAME[RoasterPulseDecoder::MSG_BYTES] = { 0x01, 0x86, 0x00, 0x00, 0x00, 0x00, 0x87 };
+
+// LOW pulse widths of that frame as the RX edge handler sees them
+size_t benchPulseTrain(unsigned long *out) {
+    size_t n = 0;
+    out[n++] = 8000;
+    for (uint8_t i = 0; i < RoasterPulseDecoder::MSG_BYTES; i++) {
+        for (uint8_t b = 0; b < RoasterPulseDecoder::BITS_PER_BYTE; b++) {
+            out[n++] = (BENCH_RX_FRAME[i] >> b) & 1 ? 1500 : 600;
+        }
+    }
+    return n;
+}
+
+void benchSuite(uint16_t iters = BENCH_ITERS) {
+    static BenchRunner bench;   // the samples are too big for the loop task's stack
+    bench.setIters(iters);
+    bench.calibrate();
+
+    // RX: per edge pulse, then per frame
+    static unsigned long pulses[1 + RoasterPulseDecoder::MSG_BYTES * RoasterPulseDecoder::BITS_PER_BYTE];
+    size_t pulseCount = benchPulseTrain(pulses);
+    RoasterPulseDecoder decoder;
+    size_t next = 0;
+    bench.run("rx_edge_decode", [&] {
+        benchSink += decoder.feed(pulses[next]);
+        if (++next == pulseCount) next = 0;
+    });
+
+    uint8_t frame[RoasterPulseDecoder::MSG_BYTES];
+    memcpy(frame, BENCH_RX_FRAME, sizeof(frame));
+    bench.run("rx_validate", [&] { benchSink += roaster.validate(frame); });
+    bench.run("rx_get_temperature", [&] { benchSink += (uint32_t)roaster.getTemperature(frame); });
+    bench.run("rx_get_temperature_fixed", [&] { benchSink += roaster.getTemperatureFixed(frame).centiC; });
+    // The cubics the tables replaced, stepping through the X range so the
+    // compiler can't fold a constant frame away
+    uint16_t rawX = 0;
+    bench.run("rx_temperature_poly", [&] {
+        benchSink += (uint32_t)polynomialTemperatureC(rawX, (frame[2] << 8) + frame[3]);
+        if (++rawX > TEMP_X_MAX) rawX = 0;
+    });
+
+    // TX
+    uint8_t control[CONTROLLER_LENGTH] = { 0 };
+    bench.run("tx_checksum", [&] {
+        control[HEAT_BYTE]++;
+        setControlChecksum(control);
+        benchSink += control[CONTROLLER_LENGTH - 1];
+    });
+
+    // Commands: only ones that leave the roaster alone
+    bench.run("cmd_parse_read", [] { parseAndExecuteCommands("READ", 4); });
+    bench.run("cmd_parse_pid_sv", [] { parseAndExecuteCommands("PID;SV;200", 10); });
+    bench.run("cmd_parse_unknown", [] { parseAndExecuteCommands("NOPE;1", 6); });
+    bench.run("cmd_read_format", [] { handleREAD(); });
+
+    // PID, on its own controller so the firmware's stays in MANUAL
+    double input = 150, output = 0, setpoint = 200;
+    PID pid(&input, &output, &setpoint, myPIDConfig.getKp(), myPIDConfig.getKi(), myPIDConfig.getKd(),
+            myPIDConfig.getPMode(), DIRECT);
+    bench.run("pid_config_apply", [&] { myPIDConfig.apply(pid); });
+
+    pid.SetSampleTime(1);
+    pid.SetMode(AUTOMATIC);
+    uint32_t step = 0;
+    bench.run("pid_compute",
+              [&] { delayMicroseconds(1000); input = 150 + (step++ % 64) * 0.25; },
+              [&] { benchSink += pid.Compute(); });
+}
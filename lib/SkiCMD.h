@@ -13,9 +13,9 @@
  * along with this program.  If not, see <https://www.gnu.org/licenses/>.
  */
 
-#include "PID_v1.h"
+#include "SkiPID.h"
 // -----------------------------------------------------------------------------
-// All HiBean commands TO roaster
+// All commands TO roaster, from HiBean over BLE or a wired port (SkiTransport.h)
 // -----------------------------------------------------------------------------
 
 // -----------------------------------------------------------------------------
@@ -23,51 +23,13 @@
 // -----------------------------------------------------------------------------
 extern double temp;
 extern char CorF;
+extern TempFilter tempFilter;
 extern PID myPID;
 extern PIDConfig myPIDConfig;
 extern double pInput, pOutput, pSetpoint;
 extern int manualHeatLevel;
-
-// -----------------------------------------------------------------------------
-// Timing Constants
-// -----------------------------------------------------------------------------
-const int PULSE_ONE       = 1200;
-const int PULSE_ZERO      = 650;
-const int POST_PULSE_DELAY= 750;
-const int START_PULSE     = 7500;
-const int START_DELAY     = 3800;
-
-// -----------------------------------------------------------------------------
-// Allocate buffers
-// -----------------------------------------------------------------------------
-const int CONTROLLER_LENGTH = 6;   // 6 bytes sent to roaster
-uint8_t sendBuffer[CONTROLLER_LENGTH];
-
-// -----------------------------------------------------------------------------
-// Control Byte Indices
-// -----------------------------------------------------------------------------
-enum ControlBytes {
-    VENT_BYTE = 0,
-    DRUM_BYTE = 3,
-    COOL_BYTE = 2,
-    FILTER_BYTE = 1,
-    HEAT_BYTE = 4,
-    CHECK_BYTE = 5
-};
-
-// -----------------------------------------------------------------------------
-// Command Strings(why declared if not used?)
-// https://github.com/greencardigan/TC4-shield/blob/master/applications/Artisan/aArtisan/trunk/src/aArtisan/commands.txt
-// -----------------------------------------------------------------------------
-const String CMD_READ         = "READ";
-const String CMD_HEAT         = "OT1";
-const String CMD_VENT         = "OT2";
-const String CMD_OFF          = "OFF";
-const String CMD_DRUM         = "DRUM";
-const String CMD_FILTER       = "FILTER";
-const String CMD_COOL         = "COOL";
-const String CMD_CHAN         = "CHAN";
-const String CMD_UNITS        = "UNITS";
+extern FrameScheduler frameScheduler;
+extern volatile uint16_t telemetryPeriodMs;
 
 // -----------------------------------------------------------------------------
 // Forward declarations
@@ -83,35 +45,46 @@ void handleCOOL(uint8_t value);
 void eStop();
 void handlePIDControl();
 void setPIDMode(bool usePID);
-void setValue(uint8_t* bytePtr, uint8_t value);
-void sendRoasterMessage();
+void setValue(ControlBytes index, uint8_t value);
+int formatTaskStats(char* buf, size_t len);
+int formatDiagnostics(char* buf, size_t len);
+void diagnosticsReset();
+int formatRxCalibration(char* buf, size_t len);
+void rxSetAdaptive(bool on);
+void rxResetCalibration();
 
 // -----------------------------------------------------------------------------
 // Utility Functions
 // -----------------------------------------------------------------------------
 unsigned long lastEventTime = 0;      // marker for last time we got HiBean message
+                                      // (set by controlStep() for each command from the
+                                      // controlling session or a wired transport only)
 const unsigned long LAST_EVENT_TIMEOUT = 10UL * 1000000UL; // 10 seconds (micros)
 
+// A wired transport only shows it's there by sending commands; the BLE
+// controller also by staying connected with telemetry on (see SessionTable)
 bool itsbeentoolong() {
   unsigned long now = micros();
   unsigned long duration = now - lastEventTime;
-  return (duration > LAST_EVENT_TIMEOUT);
+  if (duration <= LAST_EVENT_TIMEOUT) return false;
+  return !sessions.controllerLive(LAST_EVENT_TIMEOUT / 1000, telemetryPeriodMs != 0);
 }
 
 void shutdown() {
-    for (int i = 0; i < CONTROLLER_LENGTH; i++) {
-        sendBuffer[i] = 0;
-    }
-    sendBuffer[CHECK_BYTE] = 0; // Reset checksum
+    profileRunner.stop();
+    autotune.stop();
+    myPID.SetMode(MANUAL);   // or the next Compute() turns the heat back on
+    manualHeatLevel = 0;     // and handlePIDControl() would restore it
+    frameScheduler.clear();
 }
 
 // -----------------------------------------------------------------------------
 // Command handlers
 // -----------------------------------------------------------------------------
 void handleCHAN() {
-    String message = "# Active channels set to 2100\n";
+    static const char message[] = "# Active channels set to 2100\n";
     D_println(message);
-    notifyNimBLEClient(message);
+    sendReply(message, sizeof(message) - 1);
 }
 
 void handleOT1(uint8_t value) {
@@ -125,67 +98,57 @@ void handleOT1(uint8_t value) {
 }
 
 void handleREAD() {
-    String readMsg = "0," + String(temp, 1) + "," + String(temp, 1) + "," +
-          String(sendBuffer[HEAT_BYTE]) + "," +
-          String(sendBuffer[VENT_BYTE]) + "\n";
+    char readMsg[48];
+    int len = snprintf(readMsg, sizeof(readMsg), "0,%.1f,%.1f,%u,%u\n", temp, temp,
+          frameScheduler.get(HEAT_BYTE), frameScheduler.get(VENT_BYTE));
     //D_print("READ Output: ");
     //D_println(readMsg);
 
-    notifyNimBLEClient(readMsg);
-    sendRoasterMessage(); // send heartbeat message to roaster
-    lastEventTime = micros();
+    sendReply(readMsg, min(len, (int)sizeof(readMsg) - 1), NOTIFY_READ);
 }
 
 void handleHEAT(uint8_t value) {
     if (value <= 100) {
-        setValue(&sendBuffer[HEAT_BYTE], value);
+        setValue(HEAT_BYTE, value);
     }
-    sendRoasterMessage();
-    lastEventTime = micros();
 }
 
 void handleVENT(uint8_t value) {
     if (value <= 100) {
-        setValue(&sendBuffer[VENT_BYTE], value);
+        setValue(VENT_BYTE, value);
         if (value == 0) {
             handleFILTER(value); // off
         } else {
             handleFILTER((int) round(4-((value-1)*4/100))); //convert 0-100 to inverted 4-1
         }
     }
-    sendRoasterMessage();
-    lastEventTime = micros();
 }
 
 void handleDRUM(uint8_t value) {
     if (value != 0) {
-        setValue(&sendBuffer[DRUM_BYTE], 100);
+        setValue(DRUM_BYTE, 100);
     } else {
-        setValue(&sendBuffer[DRUM_BYTE], 0);
+        setValue(DRUM_BYTE, 0);
     }
-    sendRoasterMessage();
-    lastEventTime = micros();
 }
 
 void handleFILTER(uint8_t value) {
     if (value <= 4 ) {
-        setValue(&sendBuffer[FILTER_BYTE], value); //0 off; 1 fastest -> 4 slowest
+        setValue(FILTER_BYTE, value); //0 off; 1 fastest -> 4 slowest
     }
-    sendRoasterMessage();
-    lastEventTime = micros();
 }
 
 void handleCOOL(uint8_t value) {
     if (value <= 100) {
-        setValue(&sendBuffer[COOL_BYTE], value);
+        setValue(COOL_BYTE, value);
         handleFILTER(value);
     }
-    sendRoasterMessage();
-    lastEventTime = micros();
 }
 
 void eStop() {
     D_println("Emergency Stop Activated! Heater OFF, Vent 100%");
+    profileRunner.stop();  // or it would put the vent back
+    autotune.stop();
     handleHEAT(0);   // Turn off heater
     handleVENT(100); // Set vent to 100%
 }
@@ -195,16 +158,17 @@ void eStop() {
 void handlePIDControl() {
     if (myPID.GetMode() == AUTOMATIC) {
         pInput = temp; // give current temperature as input to pid model
-        myPID.Compute();
-        int roundedHeat = std::round(pOutput / 5.0) * 5;
-        handleHEAT(roundedHeat);
-    } else {
+        if (myPID.Compute()) { // new output once per sample time, already in 5% steps
+            handleHEAT((uint8_t)std::lround(pOutput));
+        }
+    } else if (frameScheduler.get(HEAT_BYTE) != manualHeatLevel) {
         handleHEAT(manualHeatLevel);  // Use stored manual heat level
     }
 }
 
 void setPIDMode(bool usePID) {
     if (usePID) {
+        pOutput = frameScheduler.get(HEAT_BYTE); // bumpless: the PID carries on from the current heat
         myPID.SetMode(AUTOMATIC); // Enable PID
         D_println("PID mode set to AUTOMATIC");
     } else {
@@ -215,143 +179,365 @@ void setPIDMode(bool usePID) {
     }
 }
 
-void parseAndExecuteCommands(String input) {
-    input.trim();
-    input.toUpperCase();
- 
-    //D_println("Parsing command: " + input);
-
-    int split1 = input.indexOf(';');
-    String command = "";
-    String param = "";
-    String subcommand = "";
-    
-    if (split1 >= 0) {
-        command = input.substring(0, split1);
-        String remainder = input.substring(split1 + 1);
-        int split2 = remainder.indexOf(';');
-
-        if (split2 >= 0) {
-            subcommand = remainder.substring(0, split2);
-            param = remainder.substring(split2 + 1);
-        } else {
-            param = remainder;
-        }
-    } else {
-        command = input;
+// -----------------------------------------------------------------------------
+// Command parser
+// TC4-style lines (https://github.com/greencardigan/TC4-shield/blob/master/applications/Artisan/aArtisan/trunk/src/aArtisan/commands.txt)
+// are split on ';' into token views over the caller's buffer - nothing is
+// copied or allocated - and matched case-insensitively against commandTable.
+// -----------------------------------------------------------------------------
+const uint8_t CMD_MAX_TOKENS = 6;
+
+struct CmdToken {
+    const char* p;
+    uint8_t len;
+};
+
+struct CmdArgs {
+    CmdToken tok[CMD_MAX_TOKENS];
+    uint8_t count;
+};
+
+// Case-insensitive compare of a token against an upper case literal
+bool tokenIs(const CmdToken& t, const char* lit) {
+    uint8_t i = 0;
+    for (; i < t.len; i++) {
+        char c = t.p[i];
+        if (c >= 'a' && c <= 'z') c -= 'a' - 'A';
+        if (lit[i] == '\0' || c != lit[i]) return false;
     }
+    return lit[i] == '\0';
+}
+
+// Leading digits of a token, like String::toInt() (0 if none)
+long tokenToInt(const CmdToken& t) {
+    uint8_t i = 0;
+    while (i < t.len && t.p[i] == ' ') i++;
+    bool neg = false;
+    if (i < t.len && (t.p[i] == '-' || t.p[i] == '+')) neg = (t.p[i++] == '-');
+    long v = 0;
+    for (; i < t.len && t.p[i] >= '0' && t.p[i] <= '9'; i++) v = v * 10 + (t.p[i] - '0');
+    return neg ? -v : v;
+}
+
+// Decimal number of a token, like String::toDouble() (0 if none)
+double tokenToDouble(const CmdToken& t) {
+    uint8_t i = 0;
+    while (i < t.len && t.p[i] == ' ') i++;
+    bool neg = false;
+    if (i < t.len && (t.p[i] == '-' || t.p[i] == '+')) neg = (t.p[i++] == '-');
+    double v = 0;
+    for (; i < t.len && t.p[i] >= '0' && t.p[i] <= '9'; i++) v = v * 10 + (t.p[i] - '0');
+    if (i < t.len && t.p[i] == '.') {
+        double scale = 0.1;
+        for (i++; i < t.len && t.p[i] >= '0' && t.p[i] <= '9'; i++, scale *= 0.1) v += (t.p[i] - '0') * scale;
+    }
+    return neg ? -v : v;
+}
 
-    if (command == "PID") {
-        if (param == "ON") {
-            setPIDMode(true);  // Enable PID control
-        } else if (param == "OFF") {
-            setPIDMode(false); // Disable PID control
-        } else if (subcommand == "SV") {
-            double newSetpoint = param.toDouble();
-            if (newSetpoint > 0 && newSetpoint <= 300) {  // Example range check
-                pSetpoint = newSetpoint;
-                D_print("New Setpoint: ");
-                D_println(pSetpoint);
-            }
-        } else if (subcommand == "T") {
-            double pidTune[3]; //pp.p;ii.i;dd.d
-            int paramCount = 0;
-            while(param.length() > 0) {
-                int index = param.indexOf(';');
-                if (index == -1) { // No delim found
-                    pidTune[paramCount++] = param.toDouble(); //remaining string
-                    break;
-                } else {
-                    pidTune[paramCount++] = param.substring(0, index).toDouble(); //grab first
-                    param = param.substring(index+1); //trim string
-                }
-            }
-            myPIDConfig.setKp(pidTune[0]);
-            myPIDConfig.setKi(pidTune[1]);
-            myPIDConfig.setKd(pidTune[2]);
-            myPIDConfig.apply(myPID); // apply the pid params to running config
-        } else if (subcommand == "PM") {
-            D_print("Setting PMode to: ");
-            D_println(param);
-            if (param == "M") {
-              myPIDConfig.setPMode(P_ON_M);
-              myPIDConfig.apply(myPID); // apply the pid params to running config
-            } else {
-              myPIDConfig.setPMode(P_ON_E);
-              myPIDConfig.apply(myPID); // apply the pid params to running config
-            }
-        } else if (subcommand == "CT") {
-            D_print("Setting Cycle Time to: ");
-            D_println(param.toInt());
-            myPIDConfig.setSampleTime(param.toInt());
-            myPIDConfig.apply(myPID);
+// Split on ';' after trimming the line, false if there are too many tokens
+bool tokenizeCommand(const char* input, size_t len, CmdArgs& args) {
+    while (len > 0 && isspace((unsigned char)input[0])) { input++; len--; }
+    while (len > 0 && isspace((unsigned char)input[len - 1])) len--;
+
+    args.count = 0;
+    size_t start = 0;
+    for (size_t i = 0; i <= len; i++) {
+        if (i == len || input[i] == ';') {
+            if (args.count >= CMD_MAX_TOKENS || i - start > 0xFF) return false;
+            args.tok[args.count].p = input + start;
+            args.tok[args.count].len = i - start;
+            args.count++;
+            start = i + 1;
         }
-    } else if (command == "OT1") {  
-        D_println("Setting OT1: " + param);
-        handleOT1(param.toInt());  // Manual heater control (only in MANUAL mode)
-    } else if (command == "READ") {
-        handleREAD();
-    } else if (command == "OT2") { 
-        D_println("Setting OT2: " + param); 
-        handleVENT(param.toInt());  // Set fan duty
-    } else if (command == "OFF") {  
-        shutdown();  // Shut down system
-    } else if (command == "ESTOP") {  
-        eStop();  // Emergency stop (heater = 0, vent = 100)
-    } else if (command == "DRUM") {  
-        D_println("Setting Drum: " + param); 
-        handleDRUM(param.toInt());  // Start/stop the drum
-    } else if (command == "FILTER") { 
-        D_println("Setting Filter: " + param);  
-        handleFILTER(param.toInt());  // Turn on/off filter fan
-    } else if (command == "COOL") {  
-        D_println("Setting Cool: " + param);  
-        handleCOOL(param.toInt());  // Cool the beans
-    } else if (command == "CHAN") {  
-        handleCHAN();  // Handle TC4 init message
-    } else if (command == "UNITS") {  
-        if (split1 >= 0) CorF = input.charAt(split1 + 1);  // Set temperature units
     }
+    return true;
+}
+
+// --- Table handlers: argument counts are already checked ---
+void cmdRead(const CmdArgs&)  { handleREAD(); }
+void cmdChan(const CmdArgs&)  { handleCHAN(); }  // Handle TC4 init message
+void cmdOff(const CmdArgs&)   { shutdown(); }    // Shut down system
+void cmdEStop(const CmdArgs&) { eStop(); }       // Emergency stop (heater = 0, vent = 100)
+
+void cmdOT1(const CmdArgs& a) {
+    D_print("Setting OT1: "); D_println(tokenToInt(a.tok[1]));
+    handleOT1(tokenToInt(a.tok[1]));  // Manual heater control (only in MANUAL mode)
+}
+
+void cmdOT2(const CmdArgs& a) {
+    D_print("Setting OT2: "); D_println(tokenToInt(a.tok[1]));
+    handleVENT(tokenToInt(a.tok[1]));  // Set fan duty
 }
 
-void pulsePin(int pin, int duration) {
-  #if SERIAL_DEBUG == 0
-    digitalWrite(pin, LOW);
-    delayMicroseconds(duration);
-    digitalWrite(pin, HIGH);
-  #endif
+void cmdDrum(const CmdArgs& a) {
+    D_print("Setting Drum: "); D_println(tokenToInt(a.tok[1]));
+    handleDRUM(tokenToInt(a.tok[1]));  // Start/stop the drum
 }
 
-// Control Bytes & Checksum
-void setControlChecksum() {
-    uint8_t sum = 0;
-    for (int i = 0; i < (CONTROLLER_LENGTH - 1); i++) {
-        sum += sendBuffer[i];
+void cmdFilter(const CmdArgs& a) {
+    D_print("Setting Filter: "); D_println(tokenToInt(a.tok[1]));
+    handleFILTER(tokenToInt(a.tok[1]));  // Turn on/off filter fan
+}
+
+void cmdCool(const CmdArgs& a) {
+    D_print("Setting Cool: "); D_println(tokenToInt(a.tok[1]));
+    handleCOOL(tokenToInt(a.tok[1]));  // Cool the beans
+}
+
+void cmdUnits(const CmdArgs& a) {
+    if (a.tok[1].len > 0) CorF = toupper(a.tok[1].p[0]);  // Set temperature units
+    if (tempFilter.valid()) temp = tempFilter.temperature(CorF);  // don't wait for the next frame
+}
+
+void cmdBtStatus(const CmdArgs&) {
+    char msg[72];
+    int len = snprintf(msg, sizeof(msg), "# BT %.1f ROR %.1f MED %u EMA %u WIN %u\n",
+          temp, tempFilter.rateOfRise(CorF), tempFilter.median(), tempFilter.ema(), tempFilter.rorWindow());
+    sendReply(msg, min(len, (int)sizeof(msg) - 1));
+}
+
+void cmdProfileStatus(const CmdArgs&) {
+    static const char* const states[] = { "EMPTY", "READY", "RUN", "PAUSE", "DONE" };
+    char msg[64];
+    int len = snprintf(msg, sizeof(msg), "# PROFILE %s %u/%u %lus SV %.1f\n",
+          states[profileRunner.state()], profileRunner.segment(), profileRunner.points(),
+          (unsigned long)(profileRunner.elapsedMs() / 1000), profileRunner.setpointDeciC() / 10.0);
+    sendReply(msg, min(len, (int)sizeof(msg) - 1));
+}
+
+void cmdProfileStart(const CmdArgs&)  { profileRunner.start(); }
+void cmdProfilePause(const CmdArgs&)  { profileRunner.pause(); }
+void cmdProfileResume(const CmdArgs&) { profileRunner.resume(); }
+void cmdProfileStop(const CmdArgs&)   { profileRunner.stop(); }
+void cmdProfileSkip(const CmdArgs& a) { profileRunner.skip(a.count > 2 ? tokenToInt(a.tok[2]) : -1); }
+
+void cmdLogStatus(const CmdArgs&) {
+    char msg[112];   // 102 with every counter at its widest
+    int len = snprintf(msg, sizeof(msg), "# LOG %s %lu samples %luB buffered, overruns %lu, last %u, saved %lu\n",
+          recorder.recording() ? "REC" : "IDLE", (unsigned long)recorder.samples(),
+          (unsigned long)recorder.buffered(), (unsigned long)recorder.overruns(), recorder.lastLog(),
+          (unsigned long)recorder.logsSaved());
+    sendReply(msg, min(len, (int)sizeof(msg) - 1));
+}
+
+void cmdLogStart(const CmdArgs&) { recorder.start(); }
+void cmdLogStop(const CmdArgs&)  { recorder.stop(); }
+
+void cmdTasks(const CmdArgs&) {
+    char msg[NOTIFY_SLOT_BYTES];
+    sendReply(msg, formatTaskStats(msg, sizeof(msg)));
+}
+
+void cmdDiag(const CmdArgs&) {
+    char msg[NOTIFY_SLOT_BYTES];
+    sendReply(msg, formatDiagnostics(msg, sizeof(msg)));
+}
+
+void cmdDiagReset(const CmdArgs&) { diagnosticsReset(); }
+
+void cmdRx(const CmdArgs&) {
+    char msg[NOTIFY_SLOT_BYTES];
+    sendReply(msg, formatRxCalibration(msg, sizeof(msg)));
+}
+
+void cmdLink(const CmdArgs&) {
+    char msg[NOTIFY_SLOT_BYTES];
+    sendReply(msg, linkManager.format(msg, sizeof(msg)));
+}
+
+void cmdRxAdapt(const CmdArgs& a) { rxSetAdaptive(tokenToInt(a.tok[2]) != 0); }
+void cmdRxReset(const CmdArgs&)   { rxResetCalibration(); }
+
+void cmdCaptureStatus(const CmdArgs&) {
+    char msg[64];
+    int len = snprintf(msg, sizeof(msg), "# CAPTURE %s %u/%u edges\n",
+          rxCapture.recording() ? "REC" : rxCapture.printing() ? "DUMP" : "IDLE",
+          (unsigned)rxCapture.edgeCount(), (unsigned)rxCapture.limit());
+    sendReply(msg, min(len, (int)sizeof(msg) - 1));
+}
+
+void cmdCaptureStart(const CmdArgs& a) { rxCapture.start(a.count > 2 ? tokenToInt(a.tok[2]) : 0); }
+void cmdCaptureStop(const CmdArgs&)    { rxCapture.stop(); }
+
+// CAPTURE;DUMP goes back the way it came, as replies of whole lines. A slice
+// the transport dropped is offered again on the next pass, so USB serial
+// carries nothing but replies and a slow reader still gets every edge.
+const uint8_t CAPTURE_DUMP_REPLIES = 4;   // per control pass
+CommandTransport* captureDumpTo = nullptr;
+
+void cmdCaptureDump(const CmdArgs&) {
+    if (replyTransport && rxCapture.dump()) captureDumpTo = replyTransport;
+}
+
+void serviceCaptureDump() {   // control task
+    if (!captureDumpTo) return;
+    char buf[NOTIFY_SLOT_BYTES];
+    for (uint8_t i = 0; i < CAPTURE_DUMP_REPLIES; i++) {
+        size_t len = rxCapture.nextSlice(buf, sizeof(buf) - 1);   // the pipe keeps a byte for its '\0'
+        if (len == 0) { captureDumpTo = nullptr; return; }
+        uint32_t dropped = captureDumpTo->repliesDropped;
+        captureDumpTo->reply(buf, len, NOTIFY_REPLY);
+        if (captureDumpTo->repliesDropped != dropped) return;   // same slice next pass
+        rxCapture.sliceSent();
+    }
+}
+
+void cmdBtMedian(const CmdArgs& a) { tempFilter.setMedian(tokenToInt(a.tok[2])); }      // 1..7 frames
+void cmdBtEma(const CmdArgs& a)    { tempFilter.setEma(tokenToInt(a.tok[2])); }         // % per frame
+void cmdBtRor(const CmdArgs& a)    { tempFilter.setRorWindow(tokenToInt(a.tok[2])); }   // seconds
+
+void cmdPidOn(const CmdArgs&)  { setPIDMode(true); }   // Enable PID control
+void cmdPidOff(const CmdArgs&) { setPIDMode(false); }  // Disable PID control
+
+void cmdPidSV(const CmdArgs& a) {
+    double newSetpoint = tokenToDouble(a.tok[2]);
+    if (newSetpoint > 0 && newSetpoint <= 300) {  // Example range check
+        pSetpoint = newSetpoint;
+        D_print("New Setpoint: ");
+        D_println(pSetpoint);
     }
-    sendBuffer[CHECK_BYTE] = sum;  // Correct use of CHECK_BYTE
-}
-
-void setValue(uint8_t* bytePtr, uint8_t value) {
-    *bytePtr = value;
-    setControlChecksum();
-}
-
-void extern sendRoasterMessage() {
-    // Start pulse
-    pulsePin(TX_PIN, START_PULSE);
-    delayMicroseconds(START_DELAY);
-
-    // Send each byte, bit by bit
-    for (int i = 0; i < CONTROLLER_LENGTH; i++) {
-        for (int j = 0; j < 8; j++) {
-            if (bitRead(sendBuffer[i], j) == 1) {
-                // '1' bit
-                pulsePin(TX_PIN, 1500);
-            } else {
-                // '0' bit
-                pulsePin(TX_PIN, PULSE_ZERO);
-            }
-            delayMicroseconds(POST_PULSE_DELAY);
+}
+
+void cmdPidTune(const CmdArgs& a) { //pp.p;ii.i;dd.d
+    myPIDConfig.setKp(tokenToDouble(a.tok[2]));
+    myPIDConfig.setKi(tokenToDouble(a.tok[3]));
+    myPIDConfig.setKd(tokenToDouble(a.tok[4]));
+    myPIDConfig.apply(myPID); // apply the pid params to running config
+}
+
+void cmdPidPMode(const CmdArgs& a) {
+    D_print("Setting PMode to: ");
+    D_println(tokenIs(a.tok[2], "M") ? "M" : "E");
+    myPIDConfig.setPMode(tokenIs(a.tok[2], "M") ? P_ON_M : P_ON_E);
+    myPIDConfig.apply(myPID); // apply the pid params to running config
+}
+
+void cmdPidCycle(const CmdArgs& a) {
+    D_print("Setting Cycle Time to: ");
+    D_println(tokenToInt(a.tok[2]));
+    myPIDConfig.setSampleTime(tokenToInt(a.tok[2]));
+    myPIDConfig.apply(myPID);
+}
+
+// PID;AT;<target>[;ZN|TL] starts a relay autotune, PID;AT;STOP ends it
+void cmdPidAutotune(const CmdArgs& a) {
+    if (a.count > 2 && tokenIs(a.tok[2], "STOP")) { autotune.stop(); return; }
+    if (a.count > 2) {
+        uint8_t rule = a.count > 3 && tokenIs(a.tok[3], "TL") ? AT_RULE_TL : AT_RULE_ZN;
+        if (!autotune.start(tokenToDouble(a.tok[2]), rule)) { D_println("Autotune not started"); }
+        return;
+    }
+
+    static const char* const states[] = { "IDLE", "RUN", "DONE", "ABORT" };
+    static const char* const results[] = { "-", "OK", "STOPPED", "OVERSHOOT", "TIMEOUT", "SENSOR", "UNSETTLED" };
+    const RelayTuner& t = autotune.relay();
+    const PIDTunings& k = autotune.applied();
+    char msg[NOTIFY_SLOT_BYTES];
+    int len = snprintf(msg, sizeof(msg), "# AT %s %s %s %u cycles %lus Ku %.2f Pu %.1fs Kp %.2f Ki %.3f Kd %.2f\n",
+          states[t.state()], results[t.result()], t.rule() == AT_RULE_TL ? "TL" : "ZN", t.cycles(),
+          (unsigned long)(t.elapsedMs() / 1000), t.ultimateGain(), t.ultimatePeriodS(), k.kP, k.kI, k.kD);
+    sendReply(msg, min(len, (int)sizeof(msg) - 1));
+}
+
+struct CommandSpec {
+    const char* name;     // first token
+    const char* sub;      // second token, or nullptr if it's an argument
+    uint8_t minTokens;    // including name (and sub)
+    uint8_t maxTokens;
+    void (*handler)(const CmdArgs& args);
+};
+
+const CommandSpec commandTable[] = {
+    { "READ",   nullptr, 1, 1, cmdRead     },
+    { "OT1",    nullptr, 2, 2, cmdOT1      },
+    { "OT2",    nullptr, 2, 2, cmdOT2      },
+    { "PID",    "SV",    3, 3, cmdPidSV    },
+    { "PID",    "T",     5, 5, cmdPidTune  },
+    { "PID",    "PM",    3, 3, cmdPidPMode },
+    { "PID",    "CT",    3, 3, cmdPidCycle },
+    { "PID",    "ON",    2, 2, cmdPidOn    },
+    { "PID",    "OFF",   2, 2, cmdPidOff   },
+    { "PID",    "AT",    2, 4, cmdPidAutotune },
+    { "DRUM",   nullptr, 2, 2, cmdDrum     },
+    { "COOL",   nullptr, 2, 2, cmdCool     },
+    { "FILTER", nullptr, 2, 2, cmdFilter   },
+    { "UNITS",  nullptr, 2, 2, cmdUnits    },
+    { "BT",     "MED",   3, 3, cmdBtMedian },
+    { "BT",     "EMA",   3, 3, cmdBtEma    },
+    { "BT",     "ROR",   3, 3, cmdBtRor    },
+    { "BT",     nullptr, 1, 1, cmdBtStatus },
+    { "CHAN",   nullptr, 1, 2, cmdChan     },
+    { "PROFILE", "START",  2, 2, cmdProfileStart  },
+    { "PROFILE", "PAUSE",  2, 2, cmdProfilePause  },
+    { "PROFILE", "RESUME", 2, 2, cmdProfileResume },
+    { "PROFILE", "STOP",   2, 2, cmdProfileStop   },
+    { "PROFILE", "SKIP",   2, 3, cmdProfileSkip   },
+    { "PROFILE", nullptr,  1, 1, cmdProfileStatus },
+    { "LOG",    "START", 2, 2, cmdLogStart  },
+    { "LOG",    "STOP",  2, 2, cmdLogStop   },
+    { "LOG",    nullptr, 1, 1, cmdLogStatus },
+    { "TASKS",  nullptr, 1, 1, cmdTasks    },
+    { "DIAG",   "RESET", 2, 2, cmdDiagReset },
+    { "DIAG",   nullptr, 1, 1, cmdDiag     },
+    { "LINK",   nullptr, 1, 1, cmdLink     },
+    { "RX",     "ADAPT", 3, 3, cmdRxAdapt  },
+    { "RX",     "RESET", 2, 2, cmdRxReset  },
+    { "RX",     nullptr, 1, 1, cmdRx       },
+    { "CAPTURE", "START", 2, 3, cmdCaptureStart  },
+    { "CAPTURE", "STOP",  2, 2, cmdCaptureStop   },
+    { "CAPTURE", "DUMP",  2, 2, cmdCaptureDump   },
+    { "CAPTURE", nullptr, 1, 1, cmdCaptureStatus },
+    { "ESTOP",  nullptr, 1, 1, cmdEStop    },
+    { "OFF",    nullptr, 1, 1, cmdOff      },
+};
+
+void parseAndExecuteCommands(const char* input, size_t len) {
+    CmdArgs args;
+    if (!tokenizeCommand(input, len, args) || args.tok[0].len == 0) return;
+
+    for (const CommandSpec& spec : commandTable) {
+        if (!tokenIs(args.tok[0], spec.name)) continue;
+        if (spec.sub && (args.count < 2 || !tokenIs(args.tok[1], spec.sub))) continue;
+        if (args.count < spec.minTokens || args.count > spec.maxTokens) {
+            D_println("Wrong number of arguments, ignored");
+            return;
         }
+        spec.handler(args);
+        return;
+    }
+}
+
+// -----------------------------------------------------------------------------
+// Command batches
+// One write can carry several commands separated by '\n' or '|', e.g.
+// "OT1;60|OT2;40|DRUM;1". They run in order as one transaction: the frame
+// scheduler holds off until the last one is done, so the roaster sees every
+// change in one frame and never a half-applied set, and their replies go
+// back together in one reply.
+// -----------------------------------------------------------------------------
+void executeCommandBatch(const char* input, size_t len) {
+    const char* end = input + len;
+    const char* sep = input;
+    while (sep < end && *sep != '\n' && *sep != '|') sep++;
+    if (sep == end) {   // the usual single command
+        parseAndExecuteCommands(input, len);
+        return;
+    }
+
+    frameScheduler.hold();
+    beginReplyBatch();
+    const char* p = input;
+    for (;;) {
+        parseAndExecuteCommands(p, sep - p);
+        if (sep == end) break;
+        p = ++sep;
+        while (sep < end && *sep != '\n' && *sep != '|') sep++;
     }
+    endReplyBatch();
+    frameScheduler.release();
+}
+
+// Handlers only change fields, frameScheduler decides when a frame goes out
+void setValue(ControlBytes index, uint8_t value) {
+    frameScheduler.set(index, value);
 }
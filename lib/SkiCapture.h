@@ -0,0 +1,129 @@
+/*
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#pragma once
+
+// -----------------------------------------------------------------------------
+// RX edge capture
+// Records the raw edges of the roaster's RX line, level and micros(), into
+// RAM, so decoder trouble seen on one roaster can be replayed on the host
+// (replay/RxReplay.cpp). CAPTURE;START arms it; it stops itself when full.
+// CAPTURE;DUMP hands it out as slices of whole lines; SkiCMD.h sends them
+// back on the transport the command came in on and only moves on once a
+// slice got through, so a slow reader still gets every edge:
+//   # rxcapture v1 edges=N
+//   <level>,<us>        one line per edge, us wraps at 2^31
+//   # end
+//
+// Each edge is one word: the level in the top bit, the time below it. With
+// the GPIO interrupt backend the edges come straight from the ISR. With RMT
+// they are rebuilt from the symbol durations of each capture, so they are
+// the edges after the RMT glitch filter, i.e. what the decoder saw.
+// -----------------------------------------------------------------------------
+
+#ifndef SKI_RX_CAPTURE_EDGES
+#define SKI_RX_CAPTURE_EDGES 4096   // 16 KB, ~35 frames
+#endif
+
+const uint32_t RX_CAPTURE_HIGH      = 0x80000000UL;
+const uint32_t RX_CAPTURE_US_MASK   = 0x7FFFFFFFUL;
+
+class RxEdgeCapture {
+public:
+    // limit 0 = all of the buffer
+    void start(size_t limit) {
+        armed = false;
+        dumping = false;
+        count = 0;
+        maxEdges = (limit == 0 || limit > SKI_RX_CAPTURE_EDGES) ? SKI_RX_CAPTURE_EDGES : limit;
+        armed = true;
+    }
+
+    void stop() { armed = false; }
+
+    // RX ISR or io task
+    void IRAM_ATTR record(uint8_t level, uint32_t us) {
+        if (!armed) return;
+        edges[count] = (us & RX_CAPTURE_US_MASK) | (level ? RX_CAPTURE_HIGH : 0);
+        if (++count >= maxEdges) armed = false;
+    }
+
+    // Handed out by nextSlice(), only once the capture has stopped
+    bool dump() {
+        if (armed || count == 0) return false;
+        dumpPos = 0;
+        dumpHeader = true;
+        dumping = true;
+        return true;
+    }
+
+    // The next lines into buf, at most room bytes, no '\0'. The same slice
+    // again until sliceSent(); 0 once the dump is over.
+    size_t nextSlice(char *buf, size_t room);
+    void sliceSent();
+
+    bool recording() const { return armed; }
+    bool printing() const { return dumping; }
+    size_t edgeCount() const { return count; }
+    size_t limit() const { return maxEdges; }
+
+private:
+    uint32_t edges[SKI_RX_CAPTURE_EDGES];
+    volatile size_t count = 0;
+    volatile bool armed = false;
+    size_t maxEdges = SKI_RX_CAPTURE_EDGES;
+
+    volatile bool dumping = false;
+    bool dumpHeader = false;
+    size_t dumpPos = 0;
+    size_t slicePos = 0;     // where the slice last handed out ends
+    bool sliceLast = false;  // and whether it carried "# end"
+};
+
+size_t RxEdgeCapture::nextSlice(char *buf, size_t room) {
+    if (!dumping) return 0;
+    size_t len = 0;
+    size_t pos = dumpPos;
+    if (dumpHeader) {
+        int n = snprintf(buf, room + 1, "# rxcapture v1 edges=%u\n", (unsigned)count);
+        len = min((size_t)n, room);
+    }
+    for (; pos < count; pos++) {
+        char line[24];
+        uint32_t e = edges[pos];
+        size_t n = snprintf(line, sizeof(line), "%u,%lu\n", e & RX_CAPTURE_HIGH ? 1 : 0,
+                            (unsigned long)(e & RX_CAPTURE_US_MASK));
+        if (len + n > room) break;
+        memcpy(buf + len, line, n);
+        len += n;
+    }
+    static const char endLine[] = "# end\n";
+    sliceLast = pos >= count && len + sizeof(endLine) - 1 <= room;
+    if (sliceLast) {
+        memcpy(buf + len, endLine, sizeof(endLine) - 1);
+        len += sizeof(endLine) - 1;
+    }
+    slicePos = pos;
+    return len;
+}
+
+void RxEdgeCapture::sliceSent() {
+    dumpHeader = false;
+    dumpPos = slicePos;
+    if (sliceLast) dumping = false;
+}
+
+RxEdgeCapture rxCapture;
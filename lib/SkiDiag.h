@@ -0,0 +1,195 @@
+/*
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+// -----------------------------------------------------------------------------
+// Field diagnostics
+// Always-on latency histograms and counters, for "laggy control" reports
+// where serial debug isn't an option. Each histogram has one writer task and
+// log2 buckets of microseconds: bucket 0 is 0 us, bucket b holds
+// [2^(b-1), 2^b) us and the last one everything above. A record is a count
+// leading zeros and an increment.
+//
+// Spans that stay on one task (tx send, io period) are timed with the CPU
+// cycle counter; spans that cross tasks or cores use the micros() stamps the
+// producer already takes, since cycle counters are per core.
+//
+// DIAG;RESET starts a new generation: each histogram clears itself the next
+// time its writer records, so no task touches another task's buckets.
+//
+// Reading the DIAG characteristic returns the blob built by diagnosticsBlob(),
+// little-endian:
+//   uint8 version, uint8 histograms, uint8 buckets, uint8 counters,
+//   uint32 ms since reset,
+//   uint32 counters[counters]              (DiagCounter order)
+//   per histogram (DiagHist order): uint32 max us, uint32 buckets[buckets]
+// -----------------------------------------------------------------------------
+
+#include <atomic>
+
+const uint8_t DIAG_VERSION = 3;
+const uint8_t DIAG_BUCKETS = 20;           // last bucket is >= 2^18 us (262 ms)
+const uint32_t DIAG_RATE_WINDOW_MS = 1000;
+
+enum DiagHist {
+    DIAG_WRITE_TO_PARSE,   // BLE write -> command parse start (ctl)
+    DIAG_CMD_TO_FRAME,     // BLE write -> first frame carrying the change (io)
+    DIAG_TX_SEND,          // RoasterTx::send() call, cycle counter (io)
+    DIAG_IO_PERIOD,        // start to start of the io step, i.e. loop() (io)
+    DIAG_NOTIFY_LATENCY,   // BLE write -> reply notify (ctl)
+    DIAG_HIST_COUNT
+};
+
+enum DiagCounter {
+    DIAG_RX_FRAMES,        // good roaster frames
+    DIAG_RX_PER_S,         // good roaster frames in the last second
+    DIAG_RX_BAD_CHECKSUM,
+    DIAG_TX_FRAMES,
+    DIAG_CMD_RING_MAX,     // deepest the command ring got
+    DIAG_CMD_RING_DROPPED,
+    DIAG_SAMPLE_BATCH_MAX, // most temperature samples control drained at once
+    DIAG_SAMPLE_DROPPED,
+    DIAG_NOTIFY_MAX,       // deepest the notify queue got
+    DIAG_NOTIFY_DROPPED,
+    DIAG_RX_ABORTED,       // roaster frames cut short by a pulse outside the windows
+    DIAG_RX_OVERRUN,       // roaster frames dropped on a full RX frame FIFO
+    DIAG_COUNTER_COUNT
+};
+
+const size_t DIAG_BLOB_BYTES = 8 + DIAG_COUNTER_COUNT * 4 + DIAG_HIST_COUNT * (1 + DIAG_BUCKETS) * 4;
+static_assert(DIAG_BLOB_BYTES <= 512, "diagnostics blob must fit one ATT long read");
+
+// -----------------------------------------------------------------------------
+// Cycle counter
+// -----------------------------------------------------------------------------
+#if defined(SKI_NATIVE)
+const uint32_t DIAG_SIM_MHZ = 160;
+inline uint32_t diagCycles() { return micros() * DIAG_SIM_MHZ; }
+inline uint32_t diagCpuMhz() { return DIAG_SIM_MHZ; }
+#else
+inline uint32_t diagCycles() { return ESP.getCycleCount(); }
+inline uint32_t diagCpuMhz() { return getCpuFrequencyMhz(); }
+#endif
+
+// -----------------------------------------------------------------------------
+// One writer's histogram
+// -----------------------------------------------------------------------------
+class DiagHistogram {
+public:
+    void record(uint32_t us, uint32_t generation) {
+        if (gen != generation) {
+            memset(buckets, 0, sizeof(buckets));
+            maxUs = 0;
+            gen = generation;
+        }
+        uint8_t b = us == 0 ? 0 : 32 - __builtin_clz(us);
+        buckets[b < DIAG_BUCKETS ? b : DIAG_BUCKETS - 1]++;
+        if (us > maxUs) maxUs = us;
+    }
+
+    bool current(uint32_t generation) const { return gen == generation; }
+    uint32_t max() const { return maxUs; }
+    uint32_t bucket(uint8_t b) const { return buckets[b]; }
+
+    // Top of the bucket holding the given percentile (at most the max), 0 if empty
+    uint32_t percentileUs(uint8_t pct) const {
+        uint32_t total = 0;
+        for (uint8_t b = 0; b < DIAG_BUCKETS; b++) total += buckets[b];
+        if (total == 0) return 0;
+        uint32_t want = (total * (uint64_t)pct + 99) / 100, seen = 0;
+        for (uint8_t b = 0; b < DIAG_BUCKETS; b++) {
+            seen += buckets[b];
+            if (seen >= want) return b == 0 ? 0 : min(maxUs, (uint32_t)(1UL << b) - 1);
+        }
+        return maxUs;
+    }
+
+private:
+    uint32_t buckets[DIAG_BUCKETS] = {};
+    uint32_t maxUs = 0;
+    uint32_t gen = 0;
+};
+
+// -----------------------------------------------------------------------------
+// The lot
+// -----------------------------------------------------------------------------
+class Diagnostics {
+public:
+    void begin() {
+        cyclesPerUs = diagCpuMhz();
+        if (cyclesPerUs == 0) cyclesPerUs = 1;
+        resetMs = rateWindowMs = millis();
+    }
+
+    void record(DiagHist h, uint32_t us) { hist[h].record(us, generation.load(std::memory_order_relaxed)); }
+    void recordCycles(DiagHist h, uint32_t startCycles) { record(h, (diagCycles() - startCycles) / cyclesPerUs); }
+
+    // io step start: the period since the last one
+    void ioTick() {
+        uint32_t now = diagCycles();
+        if (lastIoCycles) recordCycles(DIAG_IO_PERIOD, lastIoCycles);
+        lastIoCycles = now;
+    }
+
+    // Counters owned by the io task
+    void rxFrame() { rxFrames++; }
+    void rxBadChecksum() { rxBad++; }
+
+    // Per-second rates, housekeeping task
+    void service();
+
+    // Any task; see the generation note above
+    void reset() {
+        rxBase = rxFrames;
+        rxBadBase = rxBad;
+        resetMs = millis();
+        generation.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    const DiagHistogram& histogram(DiagHist h) const { return hist[h]; }
+    bool histogramCurrent(DiagHist h) const { return hist[h].current(generation.load(std::memory_order_relaxed)); }
+    uint32_t rxFrameCount() const { return rxFrames - rxBase; }
+    uint32_t rxBadCount() const { return rxBad - rxBadBase; }
+    uint32_t rxPerSecond() const { return rxRate; }
+    uint32_t msSinceReset() const { return millis() - resetMs; }
+
+private:
+    DiagHistogram hist[DIAG_HIST_COUNT];
+    std::atomic<uint32_t> generation{0};
+    uint32_t cyclesPerUs = 1;
+    uint32_t lastIoCycles = 0;
+
+    volatile uint32_t rxFrames = 0;
+    volatile uint32_t rxBad = 0;
+    uint32_t rxBase = 0;
+    uint32_t rxBadBase = 0;
+    uint32_t rxWindowStart = 0;
+    uint32_t rxRate = 0;
+    unsigned long rateWindowMs = 0;
+    unsigned long resetMs = 0;
+};
+
+void Diagnostics::service() {
+    unsigned long now = millis();
+    unsigned long elapsed = now - rateWindowMs;
+    if (elapsed < DIAG_RATE_WINDOW_MS) return;
+    uint32_t frames = rxFrames;
+    rxRate = (uint64_t)(frames - rxWindowStart) * 1000 / elapsed;
+    rxWindowStart = frames;
+    rateWindowMs = now;
+}
+
+Diagnostics diag;
@@ -0,0 +1,215 @@
+/*
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+// -----------------------------------------------------------------------------
+// Bean temperature pipeline
+// Every decoded frame goes through three stages, all integer centi-°C so the
+// result doesn't depend on the units HiBean has selected:
+//
+//   raw -> median of the last N  (drops single checksum-valid garbage frames)
+//       -> EMA                   (what the PID and READ see)
+//       -> least-squares slope over the last W seconds of medians = RoR
+//
+// The RoR fit keeps running sums over a fixed ring, adding the new sample
+// and subtracting evicted ones, so each frame costs the same no matter how
+// long the window is. Times in the sums are relative to the oldest sample
+// and get rebased as it moves, which keeps them inside int64.
+// -----------------------------------------------------------------------------
+
+const uint8_t  FILTER_MEDIAN_MAX     = 7;     // odd window sizes 1..7
+const uint8_t  FILTER_MEDIAN_DEFAULT = 3;
+const uint8_t  FILTER_EMA_DEFAULT    = 50;    // % weight of each new sample, 100 = off
+const uint8_t  FILTER_ROR_DEFAULT_S  = 15;
+const uint8_t  FILTER_ROR_MAX_S      = 30;
+const uint16_t FILTER_ROR_SLOTS      = 128;   // 30 s at ~4 frames/s fits
+const uint32_t FILTER_STALE_MS       = 5000;  // restart the fit after a gap this long
+
+class TempFilter {
+public:
+    TempFilter() { configure(FILTER_MEDIAN_DEFAULT, FILTER_EMA_DEFAULT, FILTER_ROR_DEFAULT_S); }
+
+    // --- Configuration (resets history) ---
+    void configure(uint8_t medianN, uint8_t emaPercent, uint8_t rorWindowS);
+    void setMedian(uint8_t n) { configure(n, emaPct, rorWindowS); }
+    void setEma(uint8_t percent) { configure(medianN, percent, rorWindowS); }
+    void setRorWindow(uint8_t seconds) { configure(medianN, emaPct, seconds); }
+    void reset();
+
+    uint8_t median() const { return medianN; }
+    uint8_t ema() const { return emaPct; }
+    uint8_t rorWindow() const { return rorWindowS; }
+
+    // --- Input ---
+    void add(int32_t centiC, uint32_t nowMs);
+
+    // --- Output ---
+    bool valid() const { return samples > 0; }
+    int32_t rawCentiC() const { return lastRaw; }
+    int32_t filteredCentiC() const { return (int32_t)((emaQ8 + (emaQ8 >= 0 ? 128 : -128)) / 256); }
+    int32_t rorCentiCPerMin() const { return ror; }   // 0 until the window has 2 samples
+
+    double temperature(char units) const;             // filtered, °C or °F
+    double rateOfRise(char units) const;              // °/min in the same units
+
+    uint32_t sampleCount() const { return samples; }
+
+private:
+    int32_t medianOf(int32_t centiC);
+    void fitAdd(uint32_t ms, int32_t y);
+    void fitEvict();
+    void fitSolve();
+
+    uint8_t medianN;
+    uint8_t emaPct;
+    uint8_t rorWindowS;
+
+    // median window, chronological ring plus the same values kept sorted
+    int32_t medRing[FILTER_MEDIAN_MAX];
+    int32_t medSorted[FILTER_MEDIAN_MAX];
+    uint8_t medCount;
+    uint8_t medHead;
+
+    int64_t emaQ8;          // centi-°C x256
+
+    // RoR window, sums use times relative to baseMs (the oldest sample)
+    uint32_t rorMs[FILTER_ROR_SLOTS];
+    int32_t rorY[FILTER_ROR_SLOTS];
+    uint16_t rorHead;       // oldest
+    uint16_t rorCount;
+    uint32_t baseMs;
+    int64_t sumT, sumY, sumTT, sumTY;
+    int32_t ror;
+
+    int32_t lastRaw;
+    uint32_t lastMs;
+    uint32_t samples;
+};
+
+void TempFilter::configure(uint8_t n, uint8_t emaPercent, uint8_t windowS) {
+    if (n < 1) n = 1;
+    if (n > FILTER_MEDIAN_MAX) n = FILTER_MEDIAN_MAX;
+    if ((n & 1) == 0) n++;                            // keep it odd so there is a middle
+    medianN = n;
+    emaPct = constrain(emaPercent, 1, 100);
+    rorWindowS = constrain(windowS, 2, FILTER_ROR_MAX_S);
+    reset();
+}
+
+void TempFilter::reset() {
+    medCount = medHead = 0;
+    emaQ8 = 0;
+    rorHead = rorCount = 0;
+    baseMs = 0;
+    sumT = sumY = sumTT = sumTY = 0;
+    ror = 0;
+    lastRaw = 0;
+    lastMs = 0;
+    samples = 0;
+}
+
+// Drop the oldest value from the sorted copy, insert the new one in place
+int32_t TempFilter::medianOf(int32_t centiC) {
+    if (medCount == medianN) {
+        int32_t old = medRing[medHead];
+        uint8_t i = 0;
+        while (medSorted[i] != old) i++;
+        for (; i + 1 < medCount; i++) medSorted[i] = medSorted[i + 1];
+        medCount--;
+    }
+    medRing[medHead] = centiC;
+    medHead = (medHead + 1) % medianN;
+
+    uint8_t i = medCount;
+    while (i > 0 && medSorted[i - 1] > centiC) { medSorted[i] = medSorted[i - 1]; i--; }
+    medSorted[i] = centiC;
+    medCount++;
+
+    return medSorted[(medCount - 1) / 2];  // lower middle while the window fills
+}
+
+void TempFilter::add(int32_t centiC, uint32_t nowMs) {
+    if (samples > 0 && nowMs - lastMs > FILTER_STALE_MS) reset();
+
+    lastRaw = centiC;
+    int32_t med = medianOf(centiC);
+
+    // EMA, first sample seeds it
+    int64_t medQ8 = (int64_t)med * 256;
+    if (samples == 0) emaQ8 = medQ8;
+    else emaQ8 += (medQ8 - emaQ8) * emaPct / 100;
+
+    // RoR fit over the window
+    fitAdd(nowMs, med);
+    uint32_t windowMs = (uint32_t)rorWindowS * 1000;
+    while (rorCount > 2 && nowMs - rorMs[rorHead] > windowMs) fitEvict();
+    fitSolve();
+
+    lastMs = nowMs;
+    samples++;
+}
+
+void TempFilter::fitAdd(uint32_t ms, int32_t y) {
+    if (rorCount == FILTER_ROR_SLOTS) fitEvict();
+    if (rorCount == 0) baseMs = ms;
+    int32_t t = (int32_t)(ms - baseMs);
+    uint16_t slot = (rorHead + rorCount) % FILTER_ROR_SLOTS;
+    rorMs[slot] = ms;
+    rorY[slot] = y;
+    rorCount++;
+    sumT += t;
+    sumY += y;
+    sumTT += (int64_t)t * t;
+    sumTY += (int64_t)t * y;
+}
+
+void TempFilter::fitEvict() {
+    int32_t t = (int32_t)(rorMs[rorHead] - baseMs);
+    int32_t y = rorY[rorHead];
+    sumT -= t;
+    sumY -= y;
+    sumTT -= (int64_t)t * t;
+    sumTY -= (int64_t)t * y;
+    rorHead = (rorHead + 1) % FILTER_ROR_SLOTS;
+    rorCount--;
+    if (rorCount == 0) return;
+
+    // move t = 0 to the new oldest sample: sum((t-d)^2) = sumTT - 2d*sumT + n*d^2
+    int64_t d = (int32_t)(rorMs[rorHead] - baseMs);
+    int64_t n = rorCount;
+    sumTT += n * d * d - 2 * d * sumT;
+    sumTY -= d * sumY;
+    sumT -= n * d;
+    baseMs += d;
+}
+
+void TempFilter::fitSolve() {
+    int64_t n = rorCount;
+    int64_t den = n * sumTT - sumT * sumT;
+    if (n < 2 || den <= 0) { ror = 0; return; }
+    int64_t num = (n * sumTY - sumT * sumY) * 60000;  // centi-°C per ms -> per minute
+    ror = (int32_t)((num + (num >= 0 ? den / 2 : -den / 2)) / den);
+}
+
+double TempFilter::temperature(char units) const {
+    double c = filteredCentiC() / 100.0;
+    return units == 'F' ? c * 9.0 / 5.0 + 32.0 : c;
+}
+
+double TempFilter::rateOfRise(char units) const {
+    double r = ror / 100.0;
+    return units == 'F' ? r * 9.0 / 5.0 : r;
+}
@@ -0,0 +1,268 @@
+/*
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+// -----------------------------------------------------------------------------
+// PID controller
+// Same surface and constants as the br3ttb Arduino PID library it replaces,
+// templated on the arithmetic type so the math stays off soft-float doubles:
+// float where there is an FPU (S3), Q16.16 fixed point where there isn't
+// (C6). The input, output and setpoint the caller hands in stay doubles; they
+// are converted once per Compute().
+//
+// On top of the library's behaviour:
+//   - derivative on a low-pass filtered input slope (SetDerivativeFilter)
+//   - conditional integration: the integral stops growing while the output
+//     is pinned at a limit in the same direction, on top of the sum clamp
+//   - bumpless MANUAL -> AUTOMATIC: the sum starts from the current output
+//   - outputs rounded to a quantum (SetOutputQuantum), e.g. the roaster's
+//     5% heat steps, so callers don't chase changes it can't make
+// With a filter of 1 and a quantum of 0 it computes what the library did,
+// except while saturated.
+// -----------------------------------------------------------------------------
+
+#ifndef AUTOMATIC
+#define AUTOMATIC 1
+#define MANUAL    0
+#define DIRECT    0
+#define REVERSE   1
+#define P_ON_M    0
+#define P_ON_E    1
+#endif
+
+// -----------------------------------------------------------------------------
+// Q16.16 fixed point, saturating
+// -----------------------------------------------------------------------------
+class Fix16 {
+public:
+    Fix16() : raw(0) {}
+    Fix16(int v) : raw(sat((int64_t)v << 16)) {}
+    Fix16(double v) : raw(sat((int64_t)(v * 65536.0 + (v >= 0 ? 0.5 : -0.5)))) {}
+    explicit operator double() const { return raw / 65536.0; }
+
+    friend Fix16 operator+(Fix16 a, Fix16 b) { return fromRaw(sat((int64_t)a.raw + b.raw)); }
+    friend Fix16 operator-(Fix16 a, Fix16 b) { return fromRaw(sat((int64_t)a.raw - b.raw)); }
+    friend Fix16 operator*(Fix16 a, Fix16 b) { return fromRaw(sat(((int64_t)a.raw * b.raw + 0x8000) >> 16)); }
+    friend Fix16 operator/(Fix16 a, Fix16 b) {
+        if (b.raw == 0) return fromRaw(a.raw >= 0 ? INT32_MAX : INT32_MIN);
+        return fromRaw(sat(((int64_t)a.raw << 16) / b.raw));
+    }
+    Fix16 operator-() const { return fromRaw(sat(-(int64_t)raw)); }
+
+    friend bool operator<(Fix16 a, Fix16 b) { return a.raw < b.raw; }
+    friend bool operator>(Fix16 a, Fix16 b) { return a.raw > b.raw; }
+    friend bool operator<=(Fix16 a, Fix16 b) { return a.raw <= b.raw; }
+    friend bool operator>=(Fix16 a, Fix16 b) { return a.raw >= b.raw; }
+
+    friend Fix16 pidRound(Fix16 a) { return fromRaw((int32_t)(((int64_t)a.raw + 0x8000) & ~(int64_t)0xFFFF)); }
+
+private:
+    static Fix16 fromRaw(int32_t r) { Fix16 f; f.raw = r; return f; }
+    static int32_t sat(int64_t v) { return v > INT32_MAX ? INT32_MAX : v < INT32_MIN ? INT32_MIN : (int32_t)v; }
+
+    int32_t raw;
+};
+
+inline float pidRound(float a) { return roundf(a); }
+inline double pidRound(double a) { return round(a); }
+
+// Arithmetic for the firmware's controller, -D SKI_PID_FIXED=0/1 to force it
+#ifndef SKI_PID_FIXED
+#if defined(CONFIG_IDF_TARGET_ESP32C6) || defined(CONFIG_IDF_TARGET_ESP32C3) || defined(CONFIG_IDF_TARGET_ESP32H2)
+#define SKI_PID_FIXED 1
+#else
+#define SKI_PID_FIXED 0
+#endif
+#endif
+
+#if SKI_PID_FIXED
+typedef Fix16 PIDReal;
+#else
+typedef float PIDReal;
+#endif
+
+// -----------------------------------------------------------------------------
+// Controller
+// -----------------------------------------------------------------------------
+template <typename T>
+class PIDController {
+public:
+    PIDController(double* input, double* output, double* setpoint,
+                  double kp, double ki, double kd, int pOn, int direction);
+
+    bool Compute();                   // true when a new output was written
+    void SetMode(int mode);
+    void SetOutputLimits(double min, double max);
+    void SetTunings(double kp, double ki, double kd);
+    void SetTunings(double kp, double ki, double kd, int pOn);
+    void SetControllerDirection(int direction);
+    void SetSampleTime(int sampleTimeMs);
+    void SetDerivativeFilter(double alpha);   // weight of each new slope, 1 = off
+    void SetOutputQuantum(double quantum);    // 0 = off
+
+    double GetKp() const { return dispKp; }
+    double GetKi() const { return dispKi; }
+    double GetKd() const { return dispKd; }
+    int GetMode() const { return inAuto ? AUTOMATIC : MANUAL; }
+    int GetDirection() const { return direction; }
+
+private:
+    void Initialize();
+    void scaleGains();
+    T clampOut(T v) const { return v > outMax ? outMax : v < outMin ? outMin : v; }
+
+    double* myInput;
+    double* myOutput;
+    double* mySetpoint;
+
+    double dispKp, dispKi, dispKd;    // as set, per second
+    T kp, ki, kd;                     // per sample, signed for the direction
+    T outMin, outMax;
+    T outputSum;
+    T lastInput;
+    T dFiltered;
+    T dAlpha;
+    T quantum;
+
+    unsigned long lastTime;
+    unsigned long sampleTime;
+    int direction;
+    int pOn;
+    bool inAuto;
+};
+
+template <typename T>
+PIDController<T>::PIDController(double* input, double* output, double* setpoint,
+                                double kp, double ki, double kd, int pOn, int direction)
+    : myInput(input), myOutput(output), mySetpoint(setpoint),
+      dispKp(0), dispKi(0), dispKd(0),
+      outMin(0), outMax(255), outputSum(0), lastInput(0), dFiltered(0),
+      dAlpha(1), quantum(0),
+      sampleTime(100), direction(direction), pOn(pOn), inAuto(false)
+{
+    SetTunings(kp, ki, kd, pOn);
+    lastTime = millis() - sampleTime;
+}
+
+template <typename T>
+bool PIDController<T>::Compute() {
+    if (!inAuto) return false;
+    unsigned long now = millis();
+    if (now - lastTime < sampleTime) return false;
+
+    T input = T(*myInput);
+    T error = T(*mySetpoint) - input;
+    T dInput = input - lastInput;
+    dFiltered = dFiltered + dAlpha * (dInput - dFiltered);
+
+    if (pOn == P_ON_M) outputSum = outputSum - kp * dInput;
+    T p = pOn == P_ON_E ? kp * error : T(0);
+    T d = kd * dFiltered;
+    T iTerm = ki * error;
+
+    // only integrate if that doesn't push further into a limit
+    T trial = outputSum + iTerm + p - d;
+    if (!(trial > outMax && iTerm > T(0)) && !(trial < outMin && iTerm < T(0))) {
+        outputSum = outputSum + iTerm;
+    }
+    outputSum = clampOut(outputSum);
+
+    T output = clampOut(outputSum + p - d);
+    if (quantum > T(0)) output = clampOut(pidRound(output / quantum) * quantum);
+
+    *myOutput = static_cast<double>(output);
+    lastInput = input;
+    lastTime = now;
+    return true;
+}
+
+template <typename T>
+void PIDController<T>::SetMode(int mode) {
+    bool newAuto = mode == AUTOMATIC;
+    if (newAuto && !inAuto) Initialize();
+    inAuto = newAuto;
+}
+
+// Pick up from whatever the output was in MANUAL, with no derivative kick
+template <typename T>
+void PIDController<T>::Initialize() {
+    outputSum = clampOut(T(*myOutput));
+    lastInput = T(*myInput);
+    dFiltered = T(0);
+}
+
+template <typename T>
+void PIDController<T>::SetOutputLimits(double min, double max) {
+    if (min >= max) return;
+    outMin = T(min);
+    outMax = T(max);
+    if (inAuto) {
+        *myOutput = static_cast<double>(clampOut(T(*myOutput)));
+        outputSum = clampOut(outputSum);
+    }
+}
+
+template <typename T>
+void PIDController<T>::SetTunings(double kp, double ki, double kd) {
+    SetTunings(kp, ki, kd, pOn);
+}
+
+template <typename T>
+void PIDController<T>::SetTunings(double newKp, double newKi, double newKd, int newPOn) {
+    if (newKp < 0 || newKi < 0 || newKd < 0) return;
+    pOn = newPOn;
+    dispKp = newKp;
+    dispKi = newKi;
+    dispKd = newKd;
+    scaleGains();
+}
+
+template <typename T>
+void PIDController<T>::SetControllerDirection(int newDirection) {
+    direction = newDirection;
+    scaleGains();
+}
+
+template <typename T>
+void PIDController<T>::SetSampleTime(int sampleTimeMs) {
+    if (sampleTimeMs <= 0) return;
+    sampleTime = sampleTimeMs;
+    scaleGains();
+}
+
+template <typename T>
+void PIDController<T>::SetDerivativeFilter(double alpha) {
+    if (alpha > 0 && alpha <= 1) dAlpha = T(alpha);
+}
+
+template <typename T>
+void PIDController<T>::SetOutputQuantum(double newQuantum) {
+    if (newQuantum >= 0) quantum = T(newQuantum);
+}
+
+// Per-sample gains, worked out in double here rather than on every Compute()
+template <typename T>
+void PIDController<T>::scaleGains() {
+    double sampleS = sampleTime / 1000.0;
+    double sign = direction == REVERSE ? -1.0 : 1.0;
+    kp = T(sign * dispKp);
+    ki = T(sign * dispKi * sampleS);
+    kd = T(sign * dispKd / sampleS);
+}
+
+#ifndef SKI_PID_NO_ALIAS
+typedef PIDController<PIDReal> PID;   // the firmware's controller
+#endif
@@ -15,7 +15,50 @@
 
 #pragma once
 
-#include <PID_v1.h>   // Arduino PID library
+#include "SkiPID.h"
+#include <Preferences.h>
+#include "SkiSync.h"
+
+// -----------------------------------------------------------------------------
+// Persistence
+// The config lives in NVS as one versioned blob with a CRC, read once at boot
+// (a single getBytes). Setters only mark it dirty; the housekeeping task
+// commits once commitDue() says PID_CONFIG_QUIET_MS passed without changes,
+// inside a gap the io task grants between roaster frames (see
+// FrameScheduler::quietWindow()), and only if the bytes differ from what is
+// already in flash - a burst of slider moves is one write.
+//
+// Setters may run on the BLE host task, so they only stage the values; the
+// control task, which owns the PID, picks them up with applyIfChanged().
+// -----------------------------------------------------------------------------
+const char*    PID_CONFIG_NAMESPACE = "skipid";
+const char*    PID_CONFIG_KEY       = "cfg";
+const uint8_t  PID_CONFIG_VERSION   = 1;
+const uint32_t PID_CONFIG_QUIET_MS  = 2000;
+
+const double   PID_OUTPUT_QUANTUM   = 5.0;   // the roaster takes heat in 5% steps
+const double   PID_D_FILTER         = 0.5;   // derivative smoothing, ~1 sample time constant
+
+struct PIDConfigBlob {
+    uint8_t version;
+    uint8_t pMode;
+    uint8_t maxPower;
+    uint8_t reserved;
+    int32_t sampleTime;
+    double kP;
+    double kI;
+    double kD;
+    uint32_t crc;       // CRC-32 of everything above
+};
+
+uint32_t crc32(const uint8_t* p, size_t len) {
+    uint32_t crc = 0xFFFFFFFF;
+    while (len--) {
+        crc ^= *p++;
+        for (int i = 0; i < 8; i++) crc = (crc >> 1) ^ (0xEDB88320 & (0 - (crc & 1)));
+    }
+    return ~crc;
+}
 
 class PIDConfig
 {
@@ -26,54 +69,172 @@ public:
           kD_(2.5),
           sampleTime_(500L),
           pMode_(P_ON_M),
-          maxPower_(100)
+          maxPower_(100),
+          dirty_(false),
+          unapplied_(false),
+          changedMs_(0),
+          commits_(0)
     {
+        memset(&stored_, 0, sizeof(stored_));
     }
 
     // --- Getters ---
-    double getKp() const { return kP_; }
-    double getKi() const { return kI_; }
-    double getKd() const { return kD_; }
+    double getKp() const { SpinGuard guard(lock_); return kP_; }
+    double getKi() const { SpinGuard guard(lock_); return kI_; }
+    double getKd() const { SpinGuard guard(lock_); return kD_; }
     int   getSampleTime() const { return sampleTime_; }
     int    getPMode() const { return pMode_; }
     int    getMaxPower() const { return maxPower_; }
 
     // --- Setters ---
-    void setKp(double kp) { kP_ = kp; }
-    void setKi(double ki) { kI_ = ki; }
-    void setKd(double kd) { kD_ = kd; }
+    void setKp(double kp) { update(kP_, kp); }
+    void setKi(double ki) { update(kI_, ki); }
+    void setKd(double kd) { update(kD_, kd); }
 
     void setSampleTime(int sampleTime)
     {
         if (sampleTime > 0)
-            sampleTime_ = sampleTime;
+            update(sampleTime_, sampleTime);
     }
 
     void setPMode(int mode)
     {
         if (mode == P_ON_E || mode == P_ON_M)
-            pMode_ = mode;
+            update(pMode_, mode);
     }
 
     void setMaxPower(int maxPower)
     {
         if (maxPower >= 0 && maxPower <= 100)
-            maxPower_ = maxPower;
+            update(maxPower_, maxPower);
     }
 
-    // --- Apply to Arduino PID ---
+    // --- NVS ---
+    bool load();                 // at boot, false keeps the defaults
+    bool commitDue() const { return dirty_ && millis() - changedMs_ >= PID_CONFIG_QUIET_MS; }
+    void commit();               // housekeeping only, in a quiet window
+    bool pending() const { return dirty_; }
+    uint32_t commits() const { return commits_; }
+
+    // --- Apply to the PID, control task only ---
     void apply(PID& pid) const
     {
-        pid.SetTunings(kP_, kI_, kD_, pMode_);
-        pid.SetSampleTime(sampleTime_);
-        pid.SetOutputLimits(0, maxPower_);
+        double kp, ki, kd;
+        int sampleTime, pMode, maxPower;
+        {
+            SpinGuard guard(lock_);   // one consistent set
+            kp = kP_; ki = kI_; kd = kD_;
+            sampleTime = sampleTime_; pMode = pMode_; maxPower = maxPower_;
+        }
+        pid.SetTunings(kp, ki, kd, pMode);
+        pid.SetSampleTime(sampleTime);
+        pid.SetOutputLimits(0, maxPower);
+        pid.SetOutputQuantum(PID_OUTPUT_QUANTUM);
+        pid.SetDerivativeFilter(PID_D_FILTER);
+    }
+
+    // whatever was staged since the last call
+    bool applyIfChanged(PID& pid)
+    {
+        if (!unapplied_) return false;
+        unapplied_ = false;   // before the snapshot, so a change during it isn't lost
+        apply(pid);
+        return true;
     }
 
 private:
+    template <typename T>
+    void update(T& field, T value)
+    {
+        SpinGuard guard(lock_);
+        if (field == value) return;
+        field = value;
+        dirty_ = true;
+        unapplied_ = true;
+        changedMs_ = millis();
+    }
+
+    PIDConfigBlob toBlob() const;
+
     double kP_;
     double kI_;
     double kD_;
     int   sampleTime_;
     int    pMode_;
     int    maxPower_;
+
+    mutable SpinLock lock_;       // setters run on the BLE host and control tasks
+    volatile bool dirty_;
+    volatile bool unapplied_;     // staged, not yet in the PID
+    unsigned long changedMs_;
+    PIDConfigBlob stored_;        // what flash holds
+    uint32_t commits_;
 };
+
+PIDConfigBlob PIDConfig::toBlob() const
+{
+    PIDConfigBlob b;
+    memset(&b, 0, sizeof(b));
+    b.version = PID_CONFIG_VERSION;
+    b.pMode = pMode_;
+    b.maxPower = maxPower_;
+    b.sampleTime = sampleTime_;
+    b.kP = kP_;
+    b.kI = kI_;
+    b.kD = kD_;
+    b.crc = crc32((const uint8_t*)&b, offsetof(PIDConfigBlob, crc));
+    return b;
+}
+
+bool PIDConfig::load()
+{
+    Preferences prefs;
+    if (!prefs.begin(PID_CONFIG_NAMESPACE, true)) return false;
+    PIDConfigBlob b;
+    size_t n = prefs.getBytes(PID_CONFIG_KEY, &b, sizeof(b));
+    prefs.end();
+
+    if (n != sizeof(b) || b.version != PID_CONFIG_VERSION) return false;
+    if (b.crc != crc32((const uint8_t*)&b, offsetof(PIDConfigBlob, crc))) return false;
+    if ((b.pMode != P_ON_E && b.pMode != P_ON_M) || b.maxPower > 100 || b.sampleTime <= 0) return false;
+
+    SpinGuard guard(lock_);
+    kP_ = b.kP;
+    kI_ = b.kI;
+    kD_ = b.kD;
+    sampleTime_ = b.sampleTime;
+    pMode_ = b.pMode;
+    maxPower_ = b.maxPower;
+    stored_ = b;
+    dirty_ = false;
+    return true;
+}
+
+void PIDConfig::commit()
+{
+    if (!dirty_) return;
+
+    PIDConfigBlob b;
+    {
+        SpinGuard guard(lock_);
+        b = toBlob();
+        dirty_ = false;
+    }
+    if (memcmp(&b, &stored_, sizeof(b)) == 0) return;  // changed and changed back
+
+    Preferences prefs;
+    bool ok = prefs.begin(PID_CONFIG_NAMESPACE, false);
+    if (ok) {
+        ok = prefs.putBytes(PID_CONFIG_KEY, &b, sizeof(b)) == sizeof(b);
+        prefs.end();
+    }
+    if (ok) {
+        stored_ = b;
+        commits_++;
+        return;
+    }
+    // still staged, next quiet window tries again; changedMs_ is left alone
+    // so a failed write doesn't restart the debounce
+    SpinGuard guard(lock_);
+    dirty_ = true;
+}
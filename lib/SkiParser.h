@@ -17,8 +17,388 @@
 // Message parser for messages FROM roaster (bean temperature)
 // -----------------------------------------------------------------------------
 
+#include <atomic>
+#include "SkiRing.h"
+#include "SkiSync.h"
+
 extern char CorF;
 
+// -----------------------------------------------------------------------------
+// Pulse decoder
+// Turns LOW pulse widths into 7-byte frames: a start pulse, then bits LSB
+// first (short = 0, long = 1). No I/O, so it runs the same from the GPIO
+// ISR, from RMT captures, or on the host from a vector of widths.
+//
+// The windows start at the constants below and then follow the roaster,
+// whose timing drifts from unit to unit and with temperature. Every pulse
+// goes into a running histogram, in or out of a frame and whether it fit a
+// window or not, so a unit that is off the defaults can still be found:
+// bit-sized ones in 32 us bins, start-sized ones into a running mean. That
+// is all feed() does with them, it may be running in the edge ISR.
+//
+// calibrate() does the rest from a task (the io task, or straight after
+// feed() on the host). Once RX_CAL_PULSES pulses have gone in it halves a
+// full histogram and re-estimates the 0 and 1 centres by splitting it in
+// two (a few k-means passes from the current centres). The windows are only
+// rebuilt when a centre has moved RX_CAL_HYSTERESIS_US (the start
+// RX_CAL_START_HYSTERESIS_US), and the centres are held inside fixed bounds,
+// so the bit windows never meet each other or the start pulse. New windows
+// are written to the spare of two slots and handed to feed() by one atomic
+// store of the slot index.
+// -----------------------------------------------------------------------------
+const uint16_t RX_CAL_BIN_US         = 32;
+const uint8_t  RX_CAL_BINS           = 96;     // up to 3 ms
+const uint16_t RX_CAL_MIN_WIDTH_US   = 200;    // shorter is a glitch, not a bit
+const uint16_t RX_CAL_DECAY_COUNT    = 4096;   // ~70 frames, then halve
+const uint16_t RX_CAL_PULSES         = 8 * 57; // ~8 frames
+const uint8_t  RX_CAL_PASSES         = 3;
+const uint16_t RX_CAL_MIN_SAMPLES    = 16;     // per bit value
+const uint16_t RX_CAL_HYSTERESIS_US  = 20;
+const uint16_t RX_CAL_START_HYSTERESIS_US = 200;
+
+// nominal roaster timing, and how far learning may move it
+const uint16_t RX_BIT0_NOMINAL_US    = 650;
+const uint16_t RX_BIT1_NOMINAL_US    = 1500;
+const uint16_t RX_START_NOMINAL_US   = 7500;
+const uint16_t RX_BIT0_CENTER_MIN    = 400;
+const uint16_t RX_BIT0_CENTER_MAX    = 1000;
+const uint16_t RX_BIT1_CENTER_MIN    = 1100;
+const uint16_t RX_BIT1_CENTER_MAX    = 2400;
+const uint16_t RX_BIT_GAP_MIN        = 400;
+const uint16_t RX_START_BOUND_MIN_US = 5000;
+const uint16_t RX_START_BOUND_MAX_US = 11500;
+
+struct RxWindows {
+    uint16_t startMin, startMax;   // start pulse, inclusive
+    uint16_t bit0Max;              // 0 below this
+    uint16_t bit1Min, bit1Max;     // 1 inclusive
+};
+
+class RoasterPulseDecoder {
+public:
+    static const uint8_t  MSG_BYTES     = 7;
+    static const uint8_t  BITS_PER_BYTE = 8;
+    static const uint8_t  MSG_BITS      = MSG_BYTES * BITS_PER_BYTE;
+    static const unsigned long START_MIN_US = 7000;   // defaults, until it has learned
+    static const unsigned long START_MAX_US = 10000;
+    static const unsigned long BIT0_MAX_US  = 900;
+    static const unsigned long BIT1_MIN_US  = 1200;
+    static const unsigned long BIT1_MAX_US  = 2000;
+
+    enum RxState { IDLE, RECEIVING };
+
+    RoasterPulseDecoder() { resetCalibration(); reset(); }
+
+    void reset() { rxState = IDLE; bitCount = 0; byteIndex = 0; currentByte = 0; }
+    bool feed(unsigned long lowUs);              // true when frame() holds a new message
+    // task side, true when the windows moved
+    bool calibrate() { return adaptive && observed >= RX_CAL_PULSES && recalibrate(); }
+    const uint8_t *frame() const { return buf; }
+    RxState state() const { return rxState; }
+
+    // --- Calibration ---
+    void setAdaptive(bool on) { adaptive = on; }
+    bool isAdaptive() const { return adaptive; }
+    void resetCalibration();                     // back to the default windows
+    const RxWindows &windows() const { return winSlot[winActive.load(std::memory_order_acquire)]; }
+    uint16_t bit0Center() const { return center0; }
+    uint16_t bit1Center() const { return center1; }
+    uint16_t startCenter() const { return centerStart; }
+
+    // --- Stats ---
+    uint32_t framesComplete() const { return complete; }
+    uint32_t framesAborted() const { return aborted; }      // a pulse fit no window
+    uint32_t framesBadChecksum() const { return badChecksum; }
+    uint32_t recalibrations() const { return recals; }
+
+private:
+    void observe(unsigned long lowUs);
+    bool recalibrate();
+    static bool checksumOk(const uint8_t *frame);
+
+    volatile RxState rxState;
+    uint8_t bitCount;
+    uint8_t byteIndex;
+    uint8_t currentByte;
+    uint8_t buf[MSG_BYTES];
+
+    RxWindows winSlot[2];
+    std::atomic<uint8_t> winActive{ 0 };         // the slot feed() reads
+    SpinLock calLock;                            // calibrate() against resetCalibration()
+    uint32_t calEpoch = 0;                       // bumped by every reset
+    bool adaptive = true;
+    uint16_t center0, center1;
+    volatile uint16_t centerStart;
+    uint16_t appliedStart;                       // centerStart the windows were built from
+    volatile uint16_t hist[RX_CAL_BINS];
+    volatile uint16_t histTotal;
+    volatile uint16_t observed;
+
+    uint32_t complete = 0;
+    uint32_t aborted = 0;
+    uint32_t badChecksum = 0;
+    uint32_t recals = 0;
+};
+
+bool IRAM_ATTR RoasterPulseDecoder::feed(unsigned long lowDur) {
+    if (adaptive) observe(lowDur);
+    const RxWindows &win = winSlot[winActive.load(std::memory_order_acquire)];
+
+    switch (rxState) {
+    case IDLE:
+        if (lowDur >= win.startMin && lowDur <= win.startMax) {
+            byteIndex = 0; bitCount = 0; currentByte = 0;
+            rxState = RECEIVING;
+        }
+        break;
+
+    case RECEIVING:
+        uint8_t bitVal = 0xFF;
+        if (lowDur < win.bit0Max) bitVal = 0;
+        else if (lowDur >= win.bit1Min && lowDur <= win.bit1Max) bitVal = 1;
+        else { rxState = IDLE; aborted++; return false; } // invalid pulse, abort
+
+        currentByte |= (bitVal << bitCount);
+
+        if (++bitCount >= BITS_PER_BYTE) {
+            buf[byteIndex++] = currentByte;
+            currentByte = 0;
+            bitCount = 0;
+            if (byteIndex >= MSG_BYTES) {
+                rxState = IDLE;
+                complete++;
+                if (!checksumOk(buf)) badChecksum++;
+                return true;
+            }
+        }
+        break;
+    }
+    return false;
+}
+
+bool IRAM_ATTR RoasterPulseDecoder::checksumOk(const uint8_t *frame) {
+    uint8_t sum = 0;
+    for (uint8_t i = 0; i < MSG_BYTES - 1; i++) sum += frame[i];
+    return sum == frame[MSG_BYTES - 1];
+}
+
+// Hands over the default windows like calibrate() hands over learned ones.
+// The histogram is cleared unlocked from feed()'s side: a pulse counted in
+// the middle of it is one stray sample.
+void RoasterPulseDecoder::resetCalibration() {
+    SpinGuard g(calLock);
+    RxWindows w = { (uint16_t)START_MIN_US, (uint16_t)START_MAX_US, (uint16_t)BIT0_MAX_US,
+                    (uint16_t)BIT1_MIN_US, (uint16_t)BIT1_MAX_US };
+    uint8_t spare = winActive.load(std::memory_order_relaxed) ^ 1;
+    winSlot[spare] = w;
+    winActive.store(spare, std::memory_order_release);
+    center0 = RX_BIT0_NOMINAL_US;
+    center1 = RX_BIT1_NOMINAL_US;
+    centerStart = appliedStart = RX_START_NOMINAL_US;
+    for (uint8_t b = 0; b < RX_CAL_BINS; b++) hist[b] = 0;
+    histTotal = 0;
+    observed = 0;
+    calEpoch++;
+}
+
+void IRAM_ATTR RoasterPulseDecoder::observe(unsigned long lowDur) {
+    if (lowDur >= RX_START_BOUND_MIN_US && lowDur <= RX_START_BOUND_MAX_US) {
+        centerStart += ((int32_t)lowDur - centerStart) / 8;
+    } else if (lowDur >= RX_CAL_MIN_WIDTH_US && lowDur < (uint32_t)RX_CAL_BINS * RX_CAL_BIN_US) {
+        hist[lowDur / RX_CAL_BIN_US]++;
+        histTotal++;
+    }
+    observed++;
+}
+
+bool RoasterPulseDecoder::recalibrate() {
+    observed = 0;
+    // feed() may count a pulse between the read and the write: one sample
+    if (histTotal >= RX_CAL_DECAY_COUNT) {
+        uint16_t total = 0;
+        for (uint8_t b = 0; b < RX_CAL_BINS; b++) { hist[b] /= 2; total += hist[b]; }
+        histTotal = total;
+    }
+
+    calLock.lock();
+    uint32_t epoch = calEpoch;
+    uint32_t c0 = center0, c1 = center1;
+    uint16_t prev0 = center0, prev1 = center1, prevStart = appliedStart;
+    calLock.unlock();
+
+    for (uint8_t pass = 0; pass < RX_CAL_PASSES; pass++) {
+        uint32_t boundary = (c0 + c1) / 2;
+        uint32_t sum0 = 0, n0 = 0, sum1 = 0, n1 = 0;
+        for (uint8_t b = 0; b < RX_CAL_BINS; b++) {
+            uint32_t mid = b * RX_CAL_BIN_US + RX_CAL_BIN_US / 2;
+            uint16_t n = hist[b];
+            if (mid < boundary) { sum0 += mid * n; n0 += n; }
+            else                { sum1 += mid * n; n1 += n; }
+        }
+        if (n0 < RX_CAL_MIN_SAMPLES || n1 < RX_CAL_MIN_SAMPLES) return false;
+        c0 = sum0 / n0;
+        c1 = sum1 / n1;
+    }
+    c0 = constrain(c0, RX_BIT0_CENTER_MIN, RX_BIT0_CENTER_MAX);
+    c1 = constrain(c1, RX_BIT1_CENTER_MIN, RX_BIT1_CENTER_MAX);
+    uint16_t cs = centerStart;
+    if (c1 < c0 + RX_BIT_GAP_MIN) return false;
+    if (abs((int)c0 - prev0) < RX_CAL_HYSTERESIS_US && abs((int)c1 - prev1) < RX_CAL_HYSTERESIS_US &&
+        abs((int)cs - prevStart) < RX_CAL_START_HYSTERESIS_US) return false;
+
+    // cut the gap about where the defaults do: 0 up to 30%, 1 from 65% to 160%
+    uint16_t gap = c1 - c0;
+    RxWindows w;
+    w.bit0Max = c0 + gap * 3 / 10;
+    w.bit1Min = c1 - gap * 7 / 20;
+    w.bit1Max = c1 + gap * 3 / 5;
+    // the start window only ever widens, it's far from everything else
+    w.startMin = max((int)RX_START_BOUND_MIN_US, min((int)START_MIN_US, cs - cs / 8));
+    w.startMax = min((int)RX_START_BOUND_MAX_US, max((int)START_MAX_US, cs + cs / 4));
+
+    // the spare was last read by feed() a calibration period ago, a feed()
+    // takes microseconds
+    SpinGuard g(calLock);
+    if (epoch != calEpoch) return false;   // reset while we were estimating
+    uint8_t spare = winActive.load(std::memory_order_relaxed) ^ 1;
+    winSlot[spare] = w;
+    winActive.store(spare, std::memory_order_release);
+    center0 = c0;
+    center1 = c1;
+    appliedStart = cs;
+    recals++;
+    return true;
+}
+
+// Decode a run of LOW pulse widths, calling onFrame for each complete frame.
+// Returns the number of frames found.
+typedef void (*RoasterFrameSink)(const uint8_t *frame, void *ctx);
+
+size_t decodeRoasterPulses(const unsigned long *lowUs, size_t count, RoasterFrameSink onFrame, void *ctx) {
+    RoasterPulseDecoder decoder;
+    size_t frames = 0;
+    for (size_t i = 0; i < count; i++) {
+        if (decoder.feed(lowUs[i])) {
+            frames++;
+            if (onFrame) onFrame(decoder.frame(), ctx);
+        }
+        decoder.calibrate();
+    }
+    return frames;
+}
+
+// -----------------------------------------------------------------------------
+// Temperature conversion
+// The roaster reports two raw 16-bit readings, X for the hot range and Y for
+// the cold one, each mapped to °C by a cubic. Evaluating those in double is
+// soft-float on the C6, so the cubics are sampled at compile time into
+// tables every TEMP_LUT_STEP raw counts and linearly interpolated in integer
+// math (worst case error ~0.02 °C). Only nonsensical Y readings below about
+// -230 °C fall off the table and get the polynomial.
+// -----------------------------------------------------------------------------
+struct RoasterTemp {
+    int32_t centiC;  // °C x100
+    int32_t centiF;  // °F x100
+};
+
+const uint16_t TEMP_X_MAX     = 836;   // X branch is used up to here (and Y <= 221)
+const uint16_t TEMP_Y_MIN     = 221;
+const uint8_t  TEMP_LUT_SHIFT = 3;
+const uint16_t TEMP_LUT_STEP  = 1 << TEMP_LUT_SHIFT;
+const uint16_t TEMP_Y_LUT_MAX = 1536;  // ~ -233 °C, still fits int16 centi-degrees
+const int32_t  TEMP_CENTI_LIMIT = 10000000; // clamp for off-table garbage
+
+const size_t TEMP_X_ENTRIES = (TEMP_X_MAX + TEMP_LUT_STEP - 1) / TEMP_LUT_STEP + 1;
+const size_t TEMP_Y_ENTRIES = TEMP_Y_LUT_MAX / TEMP_LUT_STEP + 1;
+
+// Reference cubics, raw counts in, °C out
+constexpr double roasterPolyX(uint32_t raw) {
+    double x = 0.001 * raw;
+    return -278.33 * x * x * x + 491.944 * x * x - 451.444 * x + 310.668;
+}
+
+constexpr double roasterPolyY(uint32_t raw) {
+    double y = 0.001 * raw;
+    return -224.2 * y * y * y + 385.9 * y * y - 327.1 * y + 171;
+}
+
+double polynomialTemperatureC(uint16_t rawTempX, uint16_t rawTempY) {
+    if (rawTempX > TEMP_X_MAX || rawTempY > TEMP_Y_MIN) return roasterPolyY(rawTempY);
+    return roasterPolyX(rawTempX);
+}
+
+template <size_t N>
+struct TempTable {
+    int16_t centiC[N];
+};
+
+template <size_t N>
+constexpr TempTable<N> makeTempTable(double (*poly)(uint32_t)) {
+    TempTable<N> t{};
+    for (size_t i = 0; i < N; i++) {
+        double c = poly(i * TEMP_LUT_STEP) * 100.0;
+        t.centiC[i] = (int16_t)(c >= 0 ? c + 0.5 : c - 0.5);
+    }
+    return t;
+}
+
+constexpr TempTable<TEMP_X_ENTRIES> TEMP_X_TABLE = makeTempTable<TEMP_X_ENTRIES>(roasterPolyX);
+constexpr TempTable<TEMP_Y_ENTRIES> TEMP_Y_TABLE = makeTempTable<TEMP_Y_ENTRIES>(roasterPolyY);
+
+int32_t lerpTempTable(const int16_t *table, uint16_t raw) {
+    uint16_t i = raw >> TEMP_LUT_SHIFT;
+    int32_t frac = raw & (TEMP_LUT_STEP - 1);
+    int32_t lo = table[i];
+    if (frac == 0) return lo;
+    int32_t delta = (table[i + 1] - lo) * frac;
+    return lo + (delta >= 0 ? delta + TEMP_LUT_STEP / 2 : delta - TEMP_LUT_STEP / 2) / TEMP_LUT_STEP;
+}
+
+RoasterTemp convertRoasterTemp(uint16_t rawTempX, uint16_t rawTempY) {
+    int32_t c;
+    if (rawTempX > TEMP_X_MAX || rawTempY > TEMP_Y_MIN) {
+        if (rawTempY <= TEMP_Y_LUT_MAX) {
+            c = lerpTempTable(TEMP_Y_TABLE.centiC, rawTempY);
+        } else {
+            double t = roasterPolyY(rawTempY) * 100.0;
+            if (t < -TEMP_CENTI_LIMIT) t = -TEMP_CENTI_LIMIT;
+            c = (int32_t)(t - 0.5);
+        }
+    } else {
+        c = lerpTempTable(TEMP_X_TABLE.centiC, rawTempX);
+    }
+
+    int32_t f9 = c * 9;
+    RoasterTemp t;
+    t.centiC = c;
+    t.centiF = (f9 >= 0 ? f9 + 2 : f9 - 2) / 5 + 3200;
+    return t;
+}
+
+// -----------------------------------------------------------------------------
+// RX backend
+// RMT timestamps the edges in hardware and frames are decoded from the capture
+// in loop() context, so BLE interrupts can't stretch the measured pulses. Set
+// SKI_RX_USE_RMT to 0 to go back to the per-edge GPIO interrupt.
+// -----------------------------------------------------------------------------
+#ifndef SKI_RX_USE_RMT
+#if defined(SOC_RMT_SUPPORTED) && SERIAL_DEBUG == 0
+#define SKI_RX_USE_RMT 1
+#else
+#define SKI_RX_USE_RMT 0
+#endif
+#endif
+
+// -----------------------------------------------------------------------------
+// Parser
+// Decoded frames wait in a small SPSC ring (SkiRing.h) with the micros() the
+// frame ended on the wire, so a consumer held up by a transmit or a delay
+// gets every frame, oldest first, with its true time. The RX interrupt (or
+// the RMT poll) produces, the io step consumes. A full ring drops the new
+// frame and counts an overrun.
+// -----------------------------------------------------------------------------
+const size_t RX_FRAME_SLOTS = 8;   // > 1 s of frames
+
 class SkyRoasterParser {
 public:
     SkyRoasterParser() : debug(false) {}
@@ -26,42 +406,59 @@ public:
     void begin(uint8_t pin);
     bool msgAvailable();
     void getMessage(uint8_t *dest);
+    bool getMessage(uint8_t *dest, uint32_t *stampUs);   // oldest frame and when it ended, false if none
     bool validate(const uint8_t *buf);
 
+    // --- Frame counters ---
+    uint32_t framesOverrun() const { return frames.overflows(); }
+    uint32_t framesAborted() const { return decoder.framesAborted(); }
+    uint32_t framesBadChecksum() const { return decoder.framesBadChecksum(); }
+    uint32_t framesQueuedMax() const { return frames.highWaterMark(); }
+
     // --- Debug ---
     void enableDebug(bool en) { debug = en; }
 
+    // --- Pulse windows ---
+    const RoasterPulseDecoder &pulseDecoder() const { return decoder; }
+    void setAdaptive(bool on) { decoder.setAdaptive(on); }
+    void resetCalibration() { decoder.resetCalibration(); }
+    void calibrate() { decoder.calibrate(); }            // io task, not the edge ISR
+
     // --- Structured Fields ---
-    double getTemperature(uint8_t *buf); // in °C units
+    double getTemperature(uint8_t *buf);                  // in CorF units
+    RoasterTemp getTemperatureFixed(const uint8_t *buf);  // both units, x100
 
 private:
     static void IRAM_ATTR edgeISR();
     void handleEdge();
+    void frameDecoded(const uint8_t *frame, uint32_t stampUs);
 
     bool debug;
     int pin;
 
-    // Protocol constants
-    static const uint8_t  MSG_BYTES     = 7;
-    static const uint8_t  BITS_PER_BYTE = 8;
-    static const unsigned long START_MIN_US = 7000;
-    static const unsigned long START_MAX_US = 10000;
-    static const unsigned long BIT0_MAX_US  = 900;
-    static const unsigned long BIT1_MIN_US  = 1200;
-    static const unsigned long BIT1_MAX_US  = 2000;
+    static const uint8_t MSG_BYTES = RoasterPulseDecoder::MSG_BYTES;
 
-    // State
-    enum RxState { IDLE, RECEIVING };
-    volatile RxState rxState = IDLE;
+    RoasterPulseDecoder decoder;
 
     volatile unsigned long lastEdgeTime = 0;
     volatile bool lastEdgeWasLow = false;
 
-    uint8_t bitCount = 0;
-    uint8_t byteIndex = 0;
-    volatile uint8_t currentByte = 0;
-    volatile uint8_t messageBuf[MSG_BYTES];
-    volatile bool newMessage = false;
+    typedef SpscRing<MSG_BYTES + 1, RX_FRAME_SLOTS> FrameRing;
+    FrameRing frames;
+
+#if SKI_RX_USE_RMT
+    // a frame is ~57 symbols; room for back-to-back frames without an idle gap
+    static const size_t RX_SYMBOLS      = 128;
+    static const uint16_t RX_IDLE_US    = 12000; // longer than any in-frame level
+    static const uint8_t RX_GLITCH_US   = 2;
+
+    rmt_data_t rxSymbols[RX_SYMBOLS];
+    size_t rxSymbolCount = 0;
+    bool rxArmed = false;
+
+    void armCapture();
+    void pollCapture();
+#endif
 
     static SkyRoasterParser *instance;
 };
@@ -70,21 +467,44 @@ SkyRoasterParser* SkyRoasterParser::instance = nullptr;
 
 void SkyRoasterParser::begin(uint8_t pin) {
     instance = this;
-    rxState = IDLE;
+    decoder.reset();
     this->pin = pin;
     pinMode(pin, INPUT_PULLUP);
+#if SKI_RX_USE_RMT
+    if (rmtInit(pin, RMT_RX_MODE, RMT_MEM_NUM_BLOCKS_2, 1000000)) {
+        rmtSetRxMaxThreshold(pin, RX_IDLE_US);
+        rmtSetRxMinThreshold(pin, RX_GLITCH_US);
+        armCapture();
+    } else {
+        D_println("RMT RX init failed!");
+    }
+#else
     attachInterrupt(digitalPinToInterrupt(pin), SkyRoasterParser::edgeISR, CHANGE);
+#endif
 }
 
 bool SkyRoasterParser::msgAvailable() {
-    return newMessage;
+#if SKI_RX_USE_RMT
+    pollCapture();
+#endif
+    return frames.front() != nullptr;
 }
 
 void SkyRoasterParser::getMessage(uint8_t *dest) {
-    noInterrupts();
-    for (uint8_t i = 0; i < MSG_BYTES; i++) dest[i] = messageBuf[i];
-    newMessage = false;
-    interrupts();
+    uint32_t stampUs;
+    getMessage(dest, &stampUs);
+}
+
+bool SkyRoasterParser::getMessage(uint8_t *dest, uint32_t *stampUs) {
+#if SKI_RX_USE_RMT
+    pollCapture();
+#endif
+    FrameRing::Slot *slot = frames.front();
+    if (!slot) return false;
+    memcpy(dest, slot->data, MSG_BYTES);
+    *stampUs = slot->stampUs;
+    frames.pop();
+    return true;
 }
 
 bool SkyRoasterParser::validate(const uint8_t *buf) {
@@ -94,24 +514,15 @@ bool SkyRoasterParser::validate(const uint8_t *buf) {
 }
 
 double SkyRoasterParser::getTemperature(uint8_t *buf) {
+    RoasterTemp t = getTemperatureFixed(buf);
+    return (CorF == 'F' ? t.centiF : t.centiC) / 100.0;
+}
+
+RoasterTemp SkyRoasterParser::getTemperatureFixed(const uint8_t *buf) {
     // Combine the first 4 bytes into a 16-bit integer (Little Endian)
     uint16_t rawTempX = ((buf[0] << 8) + buf[1]);
     uint16_t rawTempY = ((buf[2] << 8) + buf[3]);
-
-    double x = 0.001 * rawTempX;
-    double y = 0.001 * rawTempY;
-    double temperature;
-
-    if (rawTempX > 836 || rawTempY > 221) {
-        temperature = -224.2 * y * y * y + 385.9 * y * y - 327.1 * y + 171;
-    } else {
-        temperature = -278.33 * x * x * x + 491.944 * x * x - 451.444 * x + 310.668;
-    }
-
-    if (CorF == 'F') {
-        temperature = 1.8 * temperature + 32.0;
-    }
-    return temperature;
+    return convertRoasterTemp(rawTempX, rawTempY);
 }
 
 // --- Static ISR trampoline ---
@@ -119,10 +530,15 @@ void IRAM_ATTR SkyRoasterParser::edgeISR() {
     if (instance) instance->handleEdge();
 }
 
+void SkyRoasterParser::frameDecoded(const uint8_t *frame, uint32_t stampUs) {
+    frames.push((const char *)frame, MSG_BYTES, stampUs);
+}
+
 // --- Edge handler ---
 void SkyRoasterParser::handleEdge() {
     unsigned long now = micros();
     bool pinIsLow = (digitalRead(digitalPinToInterrupt(this->pin)) == LOW);
+    rxCapture.record(pinIsLow ? LOW : HIGH, now);
 
     if (pinIsLow) {
         lastEdgeTime = now;
@@ -132,39 +548,57 @@ void SkyRoasterParser::handleEdge() {
         unsigned long lowDur = now - lastEdgeTime;
         lastEdgeWasLow = false;
 
-        if(debug) {
-            D_print("Low pulse: "); D_println(lowDur);
-        }
+        if (decoder.feed(lowDur)) frameDecoded(decoder.frame(), now);
+    }
+}
 
-        switch (rxState) {
-        case IDLE:
-            if (lowDur >= START_MIN_US && lowDur <= START_MAX_US) {
-                byteIndex = 0; bitCount = 0; currentByte = 0;
-                rxState = RECEIVING;
-                if(debug) { D_println("Start detected") };
-            }
-            break;
+#if SKI_RX_USE_RMT
+// --- RMT capture ---
+void SkyRoasterParser::armCapture() {
+    rxSymbolCount = RX_SYMBOLS;
+    rxArmed = rmtReadAsync(pin, rxSymbols, &rxSymbolCount);
+}
 
-        case RECEIVING:
-            uint8_t bitVal = 0xFF;
-            if (lowDur < BIT0_MAX_US) bitVal = 0;
-            else if (lowDur >= BIT1_MIN_US && lowDur <= BIT1_MAX_US) bitVal = 1;
-            else { rxState = IDLE; if(debug) { D_println("Invalid pulse, abort"); } return; }
-
-            currentByte |= (bitVal << bitCount);
-            if(debug) { D_print(bitVal); D_print(" "); }
-
-            if (++bitCount >= BITS_PER_BYTE) {
-                messageBuf[byteIndex++] = currentByte;
-                currentByte = 0;
-                bitCount = 0;
-                if(byteIndex >= MSG_BYTES) {
-                    newMessage = true;
-                    rxState = IDLE;
-                    if(debug) { D_println("\nMessage complete"); }
-                }
-            }
+void SkyRoasterParser::pollCapture() {
+    if (!rxArmed) { armCapture(); return; }
+    if (!rmtReceiveCompleted(pin)) return;
+
+    // the capture ended an idle gap after its last edge: walk the durations
+    // forward from there to time the edges and frames
+    size_t count = rxSymbolCount;
+    uint32_t total = 0;
+    for (size_t i = 0; i < count; i++) {
+        total += rxSymbols[i].duration0 + rxSymbols[i].duration1;
+        if (rxSymbols[i].duration1 == 0) break;
+    }
+    uint32_t at = micros() - RX_IDLE_US - total;
+    bool capturing = rxCapture.recording();
+
+    // every LOW half of a symbol is a pulse width, a 0 duration ends the capture
+    for (size_t i = 0; i < count; i++) {
+        const rmt_data_t &sym = rxSymbols[i];
+        if (!sym.duration0) break;
+        if (capturing) rxCapture.record(sym.level0, at);
+        at += sym.duration0;
+        if (sym.level0 == LOW) {
+            if (debug) { D_print("Low pulse: "); D_println((unsigned long)sym.duration0); }
+            if (decoder.feed(sym.duration0)) frameDecoded(decoder.frame(), at);
+        }
+        if (sym.duration1 == 0) {
+            if (capturing) rxCapture.record(!sym.level0, at);  // into the idle level
             break;
         }
+        if (capturing) rxCapture.record(sym.level1, at);
+        at += sym.duration1;
+        if (sym.level1 == LOW) {
+            if (debug) { D_print("Low pulse: "); D_println((unsigned long)sym.duration1); }
+            if (decoder.feed(sym.duration1)) frameDecoded(decoder.frame(), at);
+        }
     }
+    if (debug && frames.front()) { D_println("Message complete"); }
+
+    // the idle gap ends a capture, a frame can't straddle two of them
+    decoder.reset();
+    armCapture();
 }
+#endif
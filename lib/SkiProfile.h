@@ -0,0 +1,301 @@
+/*
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+// -----------------------------------------------------------------------------
+// Roast profile engine
+// A profile is up to PROFILE_MAX_POINTS (time, setpoint, fan, drum) points.
+// Once started, the runner walks the curve on its own clock, interpolating
+// pSetpoint and the vent between points every PID sample time, so following
+// a profile needs no BLE traffic beyond telemetry.
+//
+// Upload, on the PROFILE characteristic, in writes that fit a 20 byte ATT
+// payload. Everything is little-endian:
+//   0x01 count                       begin, discards any half-sent upload
+//   0x02 index point[1..3]           points from index on, 6 bytes each:
+//                                      uint16 time s, int16 setpoint °C x10,
+//                                      uint8 fan %, uint8 drum (0 = off)
+//   0x03 sum16                       commit; sum16 is the byte sum of all points
+// A commit is accepted when every point arrived, times increase and the sum
+// matches; the control task then swaps it in (a running profile keeps its
+// clock). Reading the characteristic returns PROFILE_STATUS_BYTES:
+//   uint8 state, uint8 points, uint8 segment, uint16 elapsed s,
+//   int16 setpoint °C x10, uint8 last upload result (ProfileUploadResult)
+// -----------------------------------------------------------------------------
+
+extern double pSetpoint;
+extern char CorF;
+extern PID myPID;
+extern PIDConfig myPIDConfig;
+extern FrameScheduler frameScheduler;
+void handleVENT(uint8_t value);
+void handleDRUM(uint8_t value);
+void setPIDMode(bool usePID);
+void wakeControlTask();
+
+const uint8_t PROFILE_MAX_POINTS   = 32;
+const uint8_t PROFILE_POINT_BYTES  = 6;
+const uint8_t PROFILE_STATUS_BYTES = 8;
+static_assert(PROFILE_MAX_POINTS <= 32, "received points are tracked in a uint32_t mask");
+
+enum ProfileOp { PROFILE_OP_BEGIN = 1, PROFILE_OP_POINTS = 2, PROFILE_OP_COMMIT = 3 };
+
+enum ProfileState { PROFILE_EMPTY, PROFILE_READY, PROFILE_RUNNING, PROFILE_PAUSED, PROFILE_DONE };
+
+enum ProfileUploadResult {
+    PROFILE_UPLOAD_NONE, PROFILE_UPLOAD_OK, PROFILE_UPLOAD_BAD_CHUNK, PROFILE_UPLOAD_INCOMPLETE,
+    PROFILE_UPLOAD_BAD_SUM, PROFILE_UPLOAD_BAD_TIMES
+};
+
+struct ProfilePoint {
+    uint16_t timeS;
+    int16_t setpointDeciC;
+    uint8_t fan;
+    uint8_t drum;
+};
+
+struct Profile {
+    ProfilePoint points[PROFILE_MAX_POINTS];
+    uint8_t count;
+};
+
+// -----------------------------------------------------------------------------
+// Upload staging, written from the NimBLE host task
+// -----------------------------------------------------------------------------
+class ProfileUpload {
+public:
+    void chunk(const uint8_t *data, size_t len);
+    bool take(Profile &out);          // control task: adopt a committed upload
+    uint8_t lastResult() const { return result; }
+
+private:
+    uint8_t finish(uint16_t sum);
+
+    SpinLock lock;
+    Profile staged;
+    uint8_t expected = 0;
+    uint32_t receivedMask = 0;
+    bool committed = false;
+    uint8_t result = PROFILE_UPLOAD_NONE;
+};
+
+void ProfileUpload::chunk(const uint8_t *data, size_t len) {
+    if (len < 2) { result = PROFILE_UPLOAD_BAD_CHUNK; return; }
+
+    bool wake = false;
+    {
+        SpinGuard guard(lock);
+        switch (data[0]) {
+        case PROFILE_OP_BEGIN:
+            expected = data[1] <= PROFILE_MAX_POINTS ? data[1] : 0;
+            receivedMask = 0;
+            result = expected ? PROFILE_UPLOAD_NONE : PROFILE_UPLOAD_BAD_CHUNK;
+            break;
+
+        case PROFILE_OP_POINTS: {
+            uint8_t index = data[1];
+            size_t n = (len - 2) / PROFILE_POINT_BYTES;
+            if (n == 0 || (len - 2) % PROFILE_POINT_BYTES || index + n > expected) {
+                result = PROFILE_UPLOAD_BAD_CHUNK;
+                break;
+            }
+            const uint8_t *p = data + 2;
+            for (size_t i = 0; i < n; i++, p += PROFILE_POINT_BYTES) {
+                ProfilePoint &pt = staged.points[index + i];
+                pt.timeS = p[0] | (p[1] << 8);
+                pt.setpointDeciC = (int16_t)(p[2] | (p[3] << 8));
+                pt.fan = p[4] > 100 ? 100 : p[4];
+                pt.drum = p[5];
+                receivedMask |= 1UL << (index + i);
+            }
+            break;
+        }
+
+        case PROFILE_OP_COMMIT:
+            if (len < 3) { result = PROFILE_UPLOAD_BAD_CHUNK; break; }
+            result = finish(data[1] | (data[2] << 8));
+            wake = committed;
+            break;
+
+        default:
+            result = PROFILE_UPLOAD_BAD_CHUNK;
+        }
+    }
+    if (wake) wakeControlTask();
+}
+
+uint8_t ProfileUpload::finish(uint16_t sum) {
+    uint32_t all = expected == 32 ? 0xFFFFFFFFUL : (1UL << expected) - 1;  // one bit per point
+    if (expected == 0 || receivedMask != all) return PROFILE_UPLOAD_INCOMPLETE;
+
+    uint16_t check = 0;
+    for (uint8_t i = 0; i < expected; i++) {
+        const ProfilePoint &pt = staged.points[i];
+        check += (pt.timeS & 0xFF) + (pt.timeS >> 8) + ((uint16_t)pt.setpointDeciC & 0xFF) +
+                 ((uint16_t)pt.setpointDeciC >> 8) + pt.fan + pt.drum;
+        if (i > 0 && pt.timeS <= staged.points[i - 1].timeS) return PROFILE_UPLOAD_BAD_TIMES;
+    }
+    if (check != sum) return PROFILE_UPLOAD_BAD_SUM;
+
+    staged.count = expected;
+    committed = true;
+    return PROFILE_UPLOAD_OK;
+}
+
+bool ProfileUpload::take(Profile &out) {
+    SpinGuard guard(lock);
+    if (!committed) return false;
+    out = staged;
+    committed = false;
+    return true;
+}
+
+// -----------------------------------------------------------------------------
+// Runner, lives on the control task
+// -----------------------------------------------------------------------------
+class ProfileRunner {
+public:
+    void service();                   // call before handlePIDControl()
+
+    bool start();
+    void pause();
+    bool resume();
+    void stop();
+    bool skip(int point = -1);        // to the next point, or a given one
+
+    uint8_t state() const { return st; }
+    bool running() const { return st == PROFILE_RUNNING; }
+    uint8_t points() const { return profile.count; }
+    uint8_t segment() const { return seg; }
+    uint32_t elapsedMs() const { return elapsed; }
+    int16_t setpointDeciC() const { return setpoint; }
+
+private:
+    void apply();
+
+    Profile profile = {};
+    uint8_t st = PROFILE_EMPTY;
+    uint8_t seg = 0;
+    uint32_t elapsed = 0;
+    unsigned long lastMs = 0;
+    unsigned long lastApplyMs = 0;
+    int16_t setpoint = 0;
+};
+
+ProfileUpload profileUpload;
+ProfileRunner profileRunner;
+
+bool ProfileRunner::start() {
+    if (profile.count == 0) return false;
+    elapsed = 0;
+    seg = 0;
+    lastMs = millis();
+    st = PROFILE_RUNNING;
+    if (myPID.GetMode() != AUTOMATIC) setPIDMode(true);
+    apply();
+    return true;
+}
+
+void ProfileRunner::pause() {
+    if (st == PROFILE_RUNNING) st = PROFILE_PAUSED;
+}
+
+bool ProfileRunner::resume() {
+    if (st != PROFILE_PAUSED) return false;
+    lastMs = millis();
+    st = PROFILE_RUNNING;
+    return true;
+}
+
+void ProfileRunner::stop() {
+    if (st != PROFILE_EMPTY) st = PROFILE_READY;
+}
+
+bool ProfileRunner::skip(int point) {
+    if (st != PROFILE_RUNNING && st != PROFILE_PAUSED) return false;
+    uint8_t target = point < 0 ? seg + 1 : point;
+    if (target >= profile.count) return false;
+    elapsed = profile.points[target].timeS * 1000UL;
+    seg = target;
+    apply();
+    return true;
+}
+
+void ProfileRunner::service() {
+    Profile fresh;
+    if (profileUpload.take(fresh)) {
+        profile = fresh;
+        if (seg >= profile.count) seg = 0;
+        if (st == PROFILE_EMPTY || st == PROFILE_DONE) st = PROFILE_READY;
+    }
+    if (st != PROFILE_RUNNING) return;
+
+    unsigned long now = millis();
+    elapsed += now - lastMs;
+    lastMs = now;
+
+    if (now - lastApplyMs >= (unsigned long)myPIDConfig.getSampleTime()) apply();
+}
+
+// Interpolate setpoint and vent at the current elapsed time and hand them out
+void ProfileRunner::apply() {
+    lastApplyMs = millis();
+    const ProfilePoint *p = profile.points;
+    uint8_t last = profile.count - 1;
+
+    while (seg < last && elapsed >= p[seg + 1].timeS * 1000UL) seg++;
+    while (seg > 0 && elapsed < p[seg].timeS * 1000UL) seg--;
+
+    int32_t sp;
+    int32_t fan;
+    if (seg == last || elapsed <= p[seg].timeS * 1000UL) {
+        sp = p[seg].setpointDeciC;
+        fan = p[seg].fan;
+        if (seg == last && elapsed >= p[last].timeS * 1000UL) st = PROFILE_DONE;  // hold the end point
+    } else {
+        int32_t span = (p[seg + 1].timeS - p[seg].timeS) * 1000L;
+        int32_t into = elapsed - p[seg].timeS * 1000UL;
+        sp = p[seg].setpointDeciC + (int32_t)((int64_t)(p[seg + 1].setpointDeciC - p[seg].setpointDeciC) * into / span);
+        fan = p[seg].fan + (int32_t)(((int64_t)(p[seg + 1].fan - p[seg].fan) * into + span / 2) / span);
+    }
+
+    setpoint = sp;
+    pSetpoint = CorF == 'F' ? sp * 0.18 + 32.0 : sp / 10.0;
+    if (frameScheduler.get(VENT_BYTE) != fan) handleVENT(fan);
+    uint8_t drum = p[seg].drum ? 100 : 0;
+    if (frameScheduler.get(DRUM_BYTE) != drum) handleDRUM(drum);
+}
+
+// -----------------------------------------------------------------------------
+// BLE glue (SkiBLE.h only sees these declarations)
+// -----------------------------------------------------------------------------
+void profileUploadChunk(const uint8_t *data, size_t len) {
+    profileUpload.chunk(data, len);
+}
+
+size_t profileStatus(uint8_t *out) {
+    uint32_t s = profileRunner.elapsedMs() / 1000;
+    int16_t sp = profileRunner.setpointDeciC();
+    out[0] = profileRunner.state();
+    out[1] = profileRunner.points();
+    out[2] = profileRunner.segment();
+    out[3] = s;
+    out[4] = s >> 8;
+    out[5] = (uint16_t)sp;
+    out[6] = (uint16_t)sp >> 8;
+    out[7] = profileUpload.lastResult();
+    return PROFILE_STATUS_BYTES;
+}
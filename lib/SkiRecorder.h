@@ -0,0 +1,510 @@
+/*
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <LittleFS.h>
+#include <atomic>
+
+// -----------------------------------------------------------------------------
+// Flight recorder
+// While a roast is on (heat or drum running) the control task appends one
+// record every RECORD_PERIOD_MS to a byte ring in RAM - a bounded memcpy, no
+// flash, no allocation. Housekeeping drains the ring to a LittleFS file once
+// the roast has been idle for RECORD_IDLE_END_MS, or early if the ring passes
+// RECORD_SPILL_BYTES, so flash writes stay off the roaster I/O path. Each
+// flash operation - create, mark, prune, one RECORD_FLUSH_CHUNK write, close -
+// takes its own FrameScheduler::quietWindow(), so none of them overlaps a frame.
+//
+// Log file: 12 byte header, then records.
+//   header  "SKR" 0x01, uint16 period ms, uint16 reserved, uint32 start ms
+//   record  uint8 mask (RecordFields), zigzag varint bean temp °C x100 (delta
+//           from the previous record, absolute in a key record), then in mask
+//           bit order: heat, vent, drum, cool, PID output as uint8, setpoint
+//           °C x10 as zigzag varint (delta, absolute in a key record).
+//   Unchanged fields are left out. Every RECORD_KEY_EVERY records, and after
+//   an overrun, comes a key record with every field.
+//
+// Download, on the RECORDER characteristic (write or write-without-response):
+//   0x01                         list: 0x81 id16 size32 per log, then 0x84
+//   0x02 id16 offset32 credits8  stream log id from offset
+//   0x03 credits8                allow that many more data notifications
+//   0x04                         stop
+// Data comes back as 0x82 offset32 bytes..., sized to the client's MTU, one
+// notification per credit; 0x83 id16 size32 ends the log and 0x85 code is an
+// error. Resume a broken download by asking again from the last offset.
+// -----------------------------------------------------------------------------
+
+extern TempFilter tempFilter;
+extern FrameScheduler frameScheduler;
+extern PID myPID;
+extern double pOutput, pSetpoint;
+extern char CorF;
+extern NimBLECharacteristic* pRecorderCharacteristic;
+
+const uint32_t RECORD_PERIOD_MS    = 1000;
+const uint32_t RECORD_RING_BYTES   = 8192;                        // ~40 min at 1 Hz
+const uint32_t RECORD_SPILL_BYTES  = RECORD_RING_BYTES * 3 / 4;
+const uint32_t RECORD_IDLE_END_MS  = 30000;
+const uint8_t  RECORD_KEY_EVERY    = 60;
+const uint8_t  RECORD_MAX_BYTES    = 16;                          // longest record
+const uint8_t  RECORD_HEADER_BYTES = 12;
+const uint8_t  RECORD_KEEP_LOGS    = 8;
+const uint32_t RECORD_FLUSH_CHUNK  = 256;                         // bytes per quiet window
+const size_t   RECORD_CHUNK_MAX    = 244;                         // data bytes per notification
+
+static_assert((RECORD_RING_BYTES & (RECORD_RING_BYTES - 1)) == 0, "ring size must be a power of two");
+
+enum RecordFields {
+    REC_HEAT     = 0x01,
+    REC_VENT     = 0x02,
+    REC_DRUM     = 0x04,
+    REC_COOL     = 0x08,
+    REC_OUTPUT   = 0x10,
+    REC_SETPOINT = 0x20,
+    REC_KEY      = 0x40
+};
+
+enum RecorderOp {
+    REC_OP_LIST = 0x01, REC_OP_GET = 0x02, REC_OP_CREDIT = 0x03, REC_OP_STOP = 0x04,
+    REC_NOTIFY_ENTRY = 0x81, REC_NOTIFY_DATA = 0x82, REC_NOTIFY_END = 0x83,
+    REC_NOTIFY_LIST_END = 0x84, REC_NOTIFY_ERROR = 0x85
+};
+
+enum RecorderError { REC_ERR_NO_LOG = 1, REC_ERR_BAD_OFFSET = 2, REC_ERR_BAD_REQUEST = 3 };
+
+struct RecordSample {
+    int32_t btCenti;
+    uint8_t heat, vent, drum, cool, output;
+    int16_t setpointDeci;
+};
+
+// zigzag varint, at most 5 bytes
+uint8_t putVarint(uint8_t *p, int32_t v) {
+    uint32_t z = ((uint32_t)v << 1) ^ (uint32_t)(v >> 31);
+    uint8_t n = 0;
+    while (z >= 0x80) { p[n++] = (uint8_t)(z | 0x80); z >>= 7; }
+    p[n++] = (uint8_t)z;
+    return n;
+}
+
+class FlightRecorder {
+public:
+    void begin();
+
+    // --- Control task ---
+    void sample();                     // call every control pass
+    void start() { startRequested = true; }
+    void stop() { stopRequested = true; }
+    bool recording() const { return active; }
+
+    // --- Housekeeping task ---
+    bool flushDue() const;             // flash work waiting for a quiet window
+    void flushStep();                  // one flash operation, inside the window
+    void service();                    // download
+
+    // --- BLE host task ---
+    void request(const uint8_t *data, size_t len, uint16_t mtu, uint16_t connHandle);
+
+    // --- Stats ---
+    uint32_t samples() const { return sampleCount; }
+    uint32_t overruns() const { return overrunCount; }
+    uint32_t buffered() const { return head.load(std::memory_order_acquire) - tail.load(std::memory_order_acquire); }
+    uint32_t logsSaved() const { return saved; }
+    uint16_t lastLog() const { return lastId; }
+    uint32_t maxAppendUs() const { return worstAppendUs; }
+
+private:
+    // producer side
+    void beginRoast(uint32_t nowMs);
+    void endRoast();
+    bool append(const uint8_t *p, uint8_t n);
+    void readSample(RecordSample &s) const;
+
+    // consumer side
+    enum FlushStep : uint8_t { FLUSH_IDLE, FLUSH_OPEN, FLUSH_MARK, FLUSH_PRUNE, FLUSH_WRITE, FLUSH_CLOSE };
+    void planFlush();
+    void writeChunk();
+    void closeLog();
+    void serviceDownload();
+    bool notify(const uint8_t *p, size_t n);
+    void notifyError(uint8_t code);
+    void sendList();
+    void logPath(uint16_t id, char *buf, size_t len) const { snprintf(buf, len, "/roasts/%05u.skr", id); }
+
+    // ring
+    uint8_t ring[RECORD_RING_BYTES];
+    std::atomic<uint32_t> head{0};     // producer
+    std::atomic<uint32_t> tail{0};     // consumer
+    std::atomic<bool> closing{false};  // roast ended at closePos, consumer finishes the file
+    uint32_t closePos = 0;
+
+    // producer state
+    bool active = false;
+    bool startRequested = false;
+    bool stopRequested = false;
+    bool needKey = true;
+    uint8_t sinceKey = 0;
+    unsigned long lastSampleMs = 0;
+    unsigned long idleSinceMs = 0;
+    RecordSample prev = {};
+    uint32_t sampleCount = 0;
+    uint32_t overrunCount = 0;
+    uint32_t worstAppendUs = 0;
+
+    // consumer state
+    bool mounted = false;
+    File logFile;
+    uint16_t lastId = 0;
+    uint32_t saved = 0;
+    FlushStep step = FLUSH_IDLE;
+    uint32_t flushEnd = 0;             // ring position this flush runs to
+    bool flushEnding = false;          // close the log once it gets there
+
+    // download, requests posted by the BLE host task
+    SpinLock reqLock;
+    uint8_t reqOp = 0;
+    uint16_t reqId = 0;
+    uint32_t reqOffset = 0;
+    uint32_t reqCredits = 0;
+    uint16_t reqMtu = 23;
+    uint16_t reqHandle = 0xFFFF;       // BLE_HS_CONN_HANDLE_NONE
+
+    File dlFile;
+    uint16_t dlId = 0;
+    uint32_t dlOffset = 0;
+    uint32_t dlCredits = 0;
+    size_t dlChunk = 20;
+    uint16_t dlHandle = 0xFFFF;        // the central downloading
+};
+
+FlightRecorder recorder;
+
+void FlightRecorder::begin() {
+    mounted = LittleFS.begin(true);  // format on first boot
+    if (!mounted) { D_println("Recorder: LittleFS mount failed, logs stay in RAM"); return; }
+    LittleFS.mkdir("/roasts");
+
+    File f = LittleFS.open("/roasts/last", FILE_READ);
+    uint8_t b[2];
+    if (f && f.read(b, 2) == 2) lastId = b[0] | (b[1] << 8);
+    if (f) f.close();
+}
+
+// -----------------------------------------------------------------------------
+// Producer
+// -----------------------------------------------------------------------------
+void FlightRecorder::readSample(RecordSample &s) const {
+    double sp = CorF == 'F' ? (pSetpoint - 32.0) * 5.0 / 9.0 : pSetpoint;
+    s.btCenti = tempFilter.filteredCentiC();
+    s.heat = frameScheduler.get(HEAT_BYTE);
+    s.vent = frameScheduler.get(VENT_BYTE);
+    s.drum = frameScheduler.get(DRUM_BYTE);
+    s.cool = frameScheduler.get(COOL_BYTE);
+    s.output = myPID.GetMode() == AUTOMATIC ? (uint8_t)constrain(std::lround(pOutput), 0L, 100L) : s.heat;
+    s.setpointDeci = (int16_t)std::lround(constrain(sp, -3000.0, 3000.0) * 10.0);
+}
+
+bool FlightRecorder::append(const uint8_t *p, uint8_t n) {
+    uint32_t h = head.load(std::memory_order_relaxed);
+    if (RECORD_RING_BYTES - (h - tail.load(std::memory_order_acquire)) < n) return false;
+    for (uint8_t i = 0; i < n; i++) ring[(h + i) & (RECORD_RING_BYTES - 1)] = p[i];
+    head.store(h + n, std::memory_order_release);
+    return true;
+}
+
+void FlightRecorder::beginRoast(uint32_t nowMs) {
+    uint8_t hdr[RECORD_HEADER_BYTES] = { 'S', 'K', 'R', 1,
+        (uint8_t)RECORD_PERIOD_MS, (uint8_t)(RECORD_PERIOD_MS >> 8), 0, 0,
+        (uint8_t)nowMs, (uint8_t)(nowMs >> 8), (uint8_t)(nowMs >> 16), (uint8_t)(nowMs >> 24) };
+    if (!append(hdr, sizeof(hdr))) { overrunCount++; return; }
+    active = true;
+    needKey = true;
+    lastSampleMs = nowMs - RECORD_PERIOD_MS;  // first record right away
+    D_println("Recorder: roast started");
+}
+
+void FlightRecorder::endRoast() {
+    active = false;
+    closePos = head.load(std::memory_order_relaxed);
+    closing.store(true, std::memory_order_release);
+    D_println("Recorder: roast ended");
+}
+
+void FlightRecorder::sample() {
+    unsigned long now = millis();
+    bool busy = frameScheduler.get(HEAT_BYTE) || frameScheduler.get(DRUM_BYTE);
+    bool anything = busy || frameScheduler.get(VENT_BYTE) || frameScheduler.get(COOL_BYTE);
+
+    if (!active) {
+        bool go = startRequested || busy;
+        startRequested = stopRequested = false;
+        if (!go || closing.load(std::memory_order_acquire)) return;  // last roast still flushing
+        beginRoast(now);
+        if (!active) return;
+        idleSinceMs = now;
+    }
+
+    if (anything) idleSinceMs = now;
+    if (stopRequested || now - idleSinceMs >= RECORD_IDLE_END_MS) {
+        startRequested = stopRequested = false;
+        endRoast();
+        return;
+    }
+    if (now - lastSampleMs < RECORD_PERIOD_MS) return;
+    lastSampleMs += RECORD_PERIOD_MS;
+    if (now - lastSampleMs >= RECORD_PERIOD_MS) lastSampleMs = now;  // fell behind, don't burst
+
+    unsigned long t0 = micros();
+    RecordSample s;
+    readSample(s);
+
+    bool key = needKey || sinceKey >= RECORD_KEY_EVERY;
+    uint8_t rec[RECORD_MAX_BYTES];
+    uint8_t mask = key ? (REC_KEY | REC_HEAT | REC_VENT | REC_DRUM | REC_COOL | REC_OUTPUT | REC_SETPOINT) : 0;
+    if (s.heat != prev.heat) mask |= REC_HEAT;
+    if (s.vent != prev.vent) mask |= REC_VENT;
+    if (s.drum != prev.drum) mask |= REC_DRUM;
+    if (s.cool != prev.cool) mask |= REC_COOL;
+    if (s.output != prev.output) mask |= REC_OUTPUT;
+    if (s.setpointDeci != prev.setpointDeci) mask |= REC_SETPOINT;
+
+    uint8_t n = 0;
+    rec[n++] = mask;
+    n += putVarint(&rec[n], key ? s.btCenti : s.btCenti - prev.btCenti);
+    if (mask & REC_HEAT) rec[n++] = s.heat;
+    if (mask & REC_VENT) rec[n++] = s.vent;
+    if (mask & REC_DRUM) rec[n++] = s.drum;
+    if (mask & REC_COOL) rec[n++] = s.cool;
+    if (mask & REC_OUTPUT) rec[n++] = s.output;
+    if (mask & REC_SETPOINT) n += putVarint(&rec[n], key ? s.setpointDeci : s.setpointDeci - prev.setpointDeci);
+
+    if (append(rec, n)) {
+        prev = s;
+        needKey = false;
+        sinceKey = key ? 1 : sinceKey + 1;
+        sampleCount++;
+    } else {
+        overrunCount++;
+        needKey = true;  // the chain is broken, restart it
+    }
+
+    uint32_t took = micros() - t0;
+    if (took > worstAppendUs) worstAppendUs = took;
+}
+
+// -----------------------------------------------------------------------------
+// Consumer
+// -----------------------------------------------------------------------------
+bool FlightRecorder::flushDue() const {
+    if (step != FLUSH_IDLE) return true;
+    if (closing.load(std::memory_order_acquire)) return true;
+    return buffered() >= RECORD_SPILL_BYTES;  // keep flash quiet mid-roast
+}
+
+// Pick what this flush writes: the whole roast when it ended, else a spill of
+// what is buffered now. Without flash the bytes are simply dropped.
+void FlightRecorder::planFlush() {
+    flushEnding = closing.load(std::memory_order_acquire);
+    uint32_t t = tail.load(std::memory_order_relaxed);
+    flushEnd = flushEnding ? closePos : head.load(std::memory_order_acquire);
+    if (!flushEnding && flushEnd - t < RECORD_SPILL_BYTES) return;
+
+    if (!mounted) {
+        tail.store(flushEnd, std::memory_order_release);
+        if (flushEnding) closing.store(false, std::memory_order_release);
+        return;
+    }
+    if (flushEnd == t) step = FLUSH_CLOSE;
+    else step = logFile ? FLUSH_WRITE : FLUSH_OPEN;
+}
+
+void FlightRecorder::writeChunk() {
+    uint32_t t = tail.load(std::memory_order_relaxed);
+    uint32_t at = t & (RECORD_RING_BYTES - 1);
+    uint32_t n = flushEnd - t;
+    if (n > RECORD_RING_BYTES - at) n = RECORD_RING_BYTES - at;
+    if (n > RECORD_FLUSH_CHUNK) n = RECORD_FLUSH_CHUNK;
+    if (logFile) logFile.write(&ring[at], n);   // open failed: drop the roast
+    tail.store(t + n, std::memory_order_release);
+    if (t + n == flushEnd) step = flushEnding ? FLUSH_CLOSE : FLUSH_IDLE;
+}
+
+void FlightRecorder::closeLog() {
+    if (logFile) {
+        logFile.close();
+        saved++;
+    }
+    closing.store(false, std::memory_order_release);
+    step = FLUSH_IDLE;
+}
+
+void FlightRecorder::flushStep() {
+    char path[24];
+    if (step == FLUSH_IDLE) planFlush();
+    switch (step) {
+    case FLUSH_IDLE:
+        break;
+    case FLUSH_OPEN:
+        lastId = lastId == 0xFFFF ? 1 : lastId + 1;
+        logPath(lastId, path, sizeof(path));
+        logFile = LittleFS.open(path, FILE_WRITE);
+        step = FLUSH_MARK;
+        break;
+    case FLUSH_MARK: {
+        File f = LittleFS.open("/roasts/last", FILE_WRITE);
+        uint8_t b[2] = { (uint8_t)lastId, (uint8_t)(lastId >> 8) };
+        if (f) { f.write(b, 2); f.close(); }
+        step = lastId > RECORD_KEEP_LOGS ? FLUSH_PRUNE : FLUSH_WRITE;
+        break;
+    }
+    case FLUSH_PRUNE:
+        logPath(lastId - RECORD_KEEP_LOGS, path, sizeof(path));
+        if (LittleFS.exists(path)) LittleFS.remove(path);
+        step = FLUSH_WRITE;
+        break;
+    case FLUSH_WRITE:
+        writeChunk();
+        break;
+    case FLUSH_CLOSE:
+        closeLog();
+        break;
+    }
+}
+
+void FlightRecorder::service() {
+    serviceDownload();
+}
+
+// -----------------------------------------------------------------------------
+// Download
+// -----------------------------------------------------------------------------
+void FlightRecorder::request(const uint8_t *data, size_t len, uint16_t mtu, uint16_t connHandle) {
+    if (len == 0) return;
+    SpinGuard guard(reqLock);
+    reqMtu = mtu;
+    reqHandle = connHandle;
+    switch (data[0]) {
+    case REC_OP_CREDIT:
+        if (len >= 2) reqCredits += data[1];
+        break;
+    case REC_OP_GET:
+        if (len < 8) { reqOp = 0xFF; break; }
+        reqOp = REC_OP_GET;
+        reqId = data[1] | (data[2] << 8);
+        reqOffset = data[3] | (data[4] << 8) | ((uint32_t)data[5] << 16) | ((uint32_t)data[6] << 24);
+        reqCredits = data[7];
+        break;
+    case REC_OP_LIST:
+    case REC_OP_STOP:
+        reqOp = data[0];
+        break;
+    default:
+        reqOp = 0xFF;
+    }
+}
+
+bool FlightRecorder::notify(const uint8_t *p, size_t n) {
+    if (!deviceConnected || !pRecorderCharacteristic) return false;
+    return pRecorderCharacteristic->notify(p, n, dlHandle);   // whoever asked
+}
+
+void FlightRecorder::notifyError(uint8_t code) {
+    uint8_t msg[2] = { REC_NOTIFY_ERROR, code };
+    notify(msg, sizeof(msg));
+}
+
+void FlightRecorder::sendList() {
+    char path[24];
+    uint16_t first = lastId > RECORD_KEEP_LOGS ? lastId - RECORD_KEEP_LOGS + 1 : 1;
+    for (uint32_t id = first; id <= lastId; id++) {
+        logPath(id, path, sizeof(path));
+        File f = LittleFS.open(path, FILE_READ);
+        if (!f) continue;
+        uint32_t size = f.size();
+        f.close();
+        uint8_t msg[7] = { REC_NOTIFY_ENTRY, (uint8_t)id, (uint8_t)(id >> 8),
+                           (uint8_t)size, (uint8_t)(size >> 8), (uint8_t)(size >> 16), (uint8_t)(size >> 24) };
+        notify(msg, sizeof(msg));
+    }
+    uint8_t end = REC_NOTIFY_LIST_END;
+    notify(&end, 1);
+}
+
+void FlightRecorder::serviceDownload() {
+    uint8_t op;
+    uint16_t id, mtu, handle;
+    uint32_t offset, credits;
+    {
+        SpinGuard guard(reqLock);
+        op = reqOp; id = reqId; offset = reqOffset; credits = reqCredits; mtu = reqMtu; handle = reqHandle;
+        reqOp = 0;
+        reqCredits = 0;
+    }
+
+    dlChunk = mtu > 8 ? mtu - 3 - 5 : 1;   // ATT header, op and offset
+    if (dlChunk > RECORD_CHUNK_MAX) dlChunk = RECORD_CHUNK_MAX;
+    dlHandle = handle;
+
+    switch (op) {
+    case REC_OP_LIST:
+        sendList();
+        break;
+    case REC_OP_STOP:
+        if (dlFile) dlFile.close();
+        dlCredits = 0;
+        break;
+    case REC_OP_GET: {
+        if (dlFile) dlFile.close();
+        dlCredits = 0;
+        char path[24];
+        logPath(id, path, sizeof(path));
+        dlFile = mounted ? LittleFS.open(path, FILE_READ) : File();
+        if (!dlFile) { notifyError(REC_ERR_NO_LOG); break; }
+        if (offset > dlFile.size() || !dlFile.seek(offset)) { dlFile.close(); notifyError(REC_ERR_BAD_OFFSET); break; }
+        dlId = id;
+        dlOffset = offset;
+        break;
+    }
+    case 0xFF:
+        notifyError(REC_ERR_BAD_REQUEST);
+        break;
+    }
+    dlCredits += credits;
+
+    uint8_t msg[5 + RECORD_CHUNK_MAX];
+    while (dlFile && dlCredits > 0) {
+        size_t n = dlFile.read(&msg[5], dlChunk);
+        if (n == 0) {
+            uint32_t size = dlFile.size();
+            uint8_t end[7] = { REC_NOTIFY_END, (uint8_t)dlId, (uint8_t)(dlId >> 8),
+                               (uint8_t)size, (uint8_t)(size >> 8), (uint8_t)(size >> 16), (uint8_t)(size >> 24) };
+            if (notify(end, sizeof(end))) dlFile.close();
+            break;
+        }
+        msg[0] = REC_NOTIFY_DATA;
+        msg[1] = dlOffset; msg[2] = dlOffset >> 8; msg[3] = dlOffset >> 16; msg[4] = dlOffset >> 24;
+        if (!notify(msg, 5 + n)) { dlFile.seek(dlOffset); break; }  // host out of buffers, retry later
+        dlOffset += n;
+        dlCredits--;
+    }
+}
+
+// -----------------------------------------------------------------------------
+// BLE glue (SkiBLE.h only sees this declaration)
+// -----------------------------------------------------------------------------
+void recorderRequest(const uint8_t *data, size_t len, uint16_t mtu, uint16_t connHandle) {
+    recorder.request(data, len, mtu, connHandle);
+}
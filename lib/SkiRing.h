@@ -0,0 +1,86 @@
+/*
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <atomic>
+
+// -----------------------------------------------------------------------------
+// Single-producer / single-consumer ring of fixed-size byte slots
+// One side (e.g. the NimBLE host task) pushes, the other (loop()) peeks and
+// pops. Head and tail are atomics owned by one side each, so no locks and no
+// heap. The consumer works on the slot in place and pops it when done.
+// -----------------------------------------------------------------------------
+template <size_t SLOT_BYTES, size_t SLOTS>
+class SpscRing {
+    static_assert((SLOTS & (SLOTS - 1)) == 0, "SLOTS must be a power of two");
+    static_assert(SLOT_BYTES > 1 && SLOT_BYTES <= 0xFFFF, "bad SLOT_BYTES");
+
+public:
+    struct Slot {
+        uint32_t stampUs;          // when the producer pushed it
+        uint16_t len;              // payload bytes, data[len] is always '\0'
+        char data[SLOT_BYTES];
+    };
+
+    SpscRing() : head(0), tail(0), overflowCount(0), oversizeCount(0), highWater(0) {}
+
+    // --- Producer ---
+    bool push(const char *data, size_t len, uint32_t stampUs) {
+        if (len >= SLOT_BYTES) { oversizeCount.fetch_add(1, std::memory_order_relaxed); return false; }
+
+        uint32_t h = head.load(std::memory_order_relaxed);
+        uint32_t used = h - tail.load(std::memory_order_acquire);
+        if (used >= SLOTS) { overflowCount.fetch_add(1, std::memory_order_relaxed); return false; }
+
+        Slot &slot = slots[h & (SLOTS - 1)];
+        memcpy(slot.data, data, len);
+        slot.data[len] = '\0';
+        slot.len = len;
+        slot.stampUs = stampUs;
+        head.store(h + 1, std::memory_order_release);
+
+        if (used + 1 > highWater.load(std::memory_order_relaxed)) highWater.store(used + 1, std::memory_order_relaxed);
+        return true;
+    }
+
+    // --- Consumer ---
+    Slot *front() {
+        uint32_t t = tail.load(std::memory_order_relaxed);
+        if (t == head.load(std::memory_order_acquire)) return nullptr;
+        return &slots[t & (SLOTS - 1)];
+    }
+
+    void pop() {
+        uint32_t t = tail.load(std::memory_order_relaxed);
+        if (t != head.load(std::memory_order_acquire)) tail.store(t + 1, std::memory_order_release);
+    }
+
+    // --- Stats (either side) ---
+    size_t depth() const { return head.load(std::memory_order_acquire) - tail.load(std::memory_order_acquire); }
+    size_t capacity() const { return SLOTS; }
+    uint32_t overflows() const { return overflowCount.load(std::memory_order_relaxed); }
+    uint32_t oversized() const { return oversizeCount.load(std::memory_order_relaxed); }
+    uint32_t highWaterMark() const { return highWater.load(std::memory_order_relaxed); }
+    void resetHighWater() { highWater.store(depth(), std::memory_order_relaxed); }
+
+private:
+    std::atomic<uint32_t> head;    // written by producer only
+    std::atomic<uint32_t> tail;    // written by consumer only
+    std::atomic<uint32_t> overflowCount;
+    std::atomic<uint32_t> oversizeCount;
+    std::atomic<uint32_t> highWater;
+    Slot slots[SLOTS];
+};
@@ -0,0 +1,210 @@
+/*
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+// -----------------------------------------------------------------------------
+// Frame scheduler
+// Owns the control bytes sent to the roaster. Handlers only change fields;
+// service() puts at most one frame on the wire per period, straight away when
+// something changed, otherwise a heartbeat so the roaster keeps hearing from us.
+// With tasks the handlers run on the control task and service() on the I/O
+// task, so the fields are guarded by a spinlock. A command batch brackets its
+// changes with hold()/release() so they go out together in one frame, never
+// half applied.
+//
+// Flash writes stall the cache, and with it the RMT refill, so they must not
+// overlap a frame. Housekeeping asks for a window with quietWindow(); service()
+// grants it once the wire is idle, withdraws it if a frame falls due before
+// housekeeping got round to it, and starts nothing while a write is under way.
+// -----------------------------------------------------------------------------
+
+#include <atomic>
+
+const int CONTROLLER_LENGTH = 6;   // 6 bytes sent to roaster
+
+// -----------------------------------------------------------------------------
+// Control Byte Indices
+// -----------------------------------------------------------------------------
+enum ControlBytes {
+    VENT_BYTE = 0,
+    DRUM_BYTE = 3,
+    COOL_BYTE = 2,
+    FILTER_BYTE = 1,
+    HEAT_BYTE = 4,
+    CHECK_BYTE = 5
+};
+
+// Control Bytes & Checksum
+void setControlChecksum(uint8_t *buf) {
+    uint8_t sum = 0;
+    for (int i = 0; i < (CONTROLLER_LENGTH - 1); i++) {
+        sum += buf[i];
+    }
+    buf[CHECK_BYTE] = sum;
+}
+
+const unsigned long FRAME_PERIOD_US    = 100000UL; // min spacing between frame starts
+const unsigned long FRAME_HEARTBEAT_US = 250000UL; // resend unchanged fields this often
+
+class FrameScheduler {
+public:
+    explicit FrameScheduler(RoasterTx &tx)
+        : tx(tx), periodUs(FRAME_PERIOD_US), heartbeatUs(FRAME_HEARTBEAT_US),
+          dirty(true), lastSendUs(0), requested(0), sent(0), heartbeats(0) {
+        for (int i = 0; i < CONTROLLER_LENGTH; i++) fields[i] = 0;
+    }
+
+    // --- Fields ---
+    void set(ControlBytes index, uint8_t value);
+    uint8_t get(ControlBytes index) const { return fields[index]; }
+    void clear();
+    void setOrigin(uint32_t writeUs) { originUs = writeUs; }  // BLE write behind the next set()s, 0 = none
+    void hold();      // no frames until release(), control task
+    void release();
+
+    // --- Cadence ---
+    void setPeriodUs(unsigned long us) { periodUs = us; }
+    void setHeartbeatUs(unsigned long us) { heartbeatUs = us; }
+
+    void service(); // call from loop()
+
+    // --- Flash window, housekeeping task ---
+    bool quietWindow();   // true once granted: write, then endQuiet()
+    void endQuiet() { quiet.store(QUIET_IDLE, std::memory_order_release); }
+
+    // --- Stats ---
+    uint32_t framesRequested() const { return requested; }   // set()s that changed a field
+    uint32_t framesSent() const { return sent; }
+    uint32_t heartbeatFrames() const { return heartbeats; }
+    uint32_t transactions() const { return holds; }
+    uint32_t framesCoalesced() const {                       // requests folded into another frame
+        uint32_t changeFrames = sent - heartbeats;
+        return requested > changeFrames ? requested - changeFrames : 0;
+    }
+    uint64_t wireTimeSavedUs() const { return (uint64_t)framesCoalesced() * tx.lastFrameUs(); }
+
+private:
+    enum QuietState : uint8_t { QUIET_IDLE, QUIET_REQUESTED, QUIET_GRANTED, QUIET_WRITING };
+
+    RoasterTx &tx;
+    unsigned long periodUs;
+    unsigned long heartbeatUs;
+
+    SpinLock lock;
+    uint8_t fields[CONTROLLER_LENGTH];
+    uint8_t frame[CONTROLLER_LENGTH];
+    bool dirty;
+    unsigned long lastSendUs;
+    uint32_t originUs = 0;          // control task only
+    uint32_t pendingWriteUs = 0;    // oldest command change not yet on the wire
+    bool commandPending = false;
+    bool held = false;
+    uint32_t holds = 0;
+    std::atomic<uint8_t> quiet{QUIET_IDLE};
+
+    uint32_t requested;
+    uint32_t sent;
+    uint32_t heartbeats;
+};
+
+void FrameScheduler::set(ControlBytes index, uint8_t value) {
+    if (index == CHECK_BYTE) return; // computed at send time
+    SpinGuard guard(lock);
+    if (fields[index] != value) {
+        requested++;   // a set() to the value already there asks for nothing
+        fields[index] = value;
+        dirty = true;
+        if (originUs && !commandPending) {
+            pendingWriteUs = originUs;
+            commandPending = true;
+        }
+    }
+}
+
+void FrameScheduler::hold() {
+    SpinGuard guard(lock);
+    held = true;
+    holds++;
+}
+
+void FrameScheduler::release() {
+    SpinGuard guard(lock);
+    held = false;
+}
+
+void FrameScheduler::clear() {
+    SpinGuard guard(lock);
+    for (int i = 0; i < CONTROLLER_LENGTH; i++) {
+        if (fields[i] != 0) dirty = true;
+        fields[i] = 0;
+    }
+}
+
+// Housekeeping moves IDLE -> REQUESTED, GRANTED -> WRITING and back to IDLE;
+// io moves REQUESTED <-> GRANTED
+bool FrameScheduler::quietWindow() {
+    uint8_t q = QUIET_GRANTED;
+    if (quiet.compare_exchange_strong(q, QUIET_WRITING, std::memory_order_acq_rel)) return true;
+    if (q == QUIET_IDLE) quiet.store(QUIET_REQUESTED, std::memory_order_release);
+    return false;
+}
+
+void FrameScheduler::service() {
+    tx.poll();
+    if (tx.busy()) return;
+
+    // the wire is idle: hand housekeeping its window if it asked
+    uint8_t q = quiet.load(std::memory_order_acquire);
+    if (q == QUIET_WRITING) return;
+    if (q == QUIET_REQUESTED) quiet.store(QUIET_GRANTED, std::memory_order_release);
+
+    unsigned long now = micros();
+    bool changed;
+    bool command;
+    uint32_t writeUs;
+    {
+        SpinGuard guard(lock);
+        if (held) return;   // a batch is part way through
+        changed = dirty;
+        if (now - lastSendUs < (changed ? periodUs : heartbeatUs)) return;
+
+        // a frame is due: take the window back unless the write already started
+        q = QUIET_GRANTED;
+        if (!quiet.compare_exchange_strong(q, QUIET_REQUESTED, std::memory_order_acq_rel) && q == QUIET_WRITING) return;
+        for (int i = 0; i < CONTROLLER_LENGTH - 1; i++) frame[i] = fields[i];
+        dirty = false;
+        command = commandPending;
+        writeUs = pendingWriteUs;
+        commandPending = false;
+    }
+    setControlChecksum(frame);
+
+    uint32_t sendStart = diagCycles();
+    bool ok = tx.send(frame, CONTROLLER_LENGTH);
+    diag.recordCycles(DIAG_TX_SEND, sendStart);
+    if (!ok) {
+        if (changed) {
+            SpinGuard guard(lock);
+            dirty = true;
+            if (command) { pendingWriteUs = writeUs; commandPending = true; }  // the older write
+        }
+        return;
+    }
+    if (command) diag.record(DIAG_CMD_TO_FRAME, now - writeUs);
+    lastSendUs = now;
+    sent++;
+    if (!changed) heartbeats++;
+}
@@ -0,0 +1,56 @@
+/*
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+// -----------------------------------------------------------------------------
+// Task model switch and the one lock we need
+// On the ESP32 targets the firmware runs as FreeRTOS tasks (see SkiTasks.h);
+// the host build keeps everything in loop(). Build with -D SKI_TASKS=0 to get
+// the single loop() on hardware too.
+// -----------------------------------------------------------------------------
+#ifndef SKI_TASKS
+#if defined(ARDUINO_ARCH_ESP32) && !defined(SKI_NATIVE)
+#define SKI_TASKS 1
+#else
+#define SKI_TASKS 0
+#endif
+#endif
+
+// Short critical section for state shared between tasks. Only hold it for a
+// few loads and stores - it masks interrupts on the calling core.
+class SpinLock {
+public:
+#if SKI_TASKS
+    SpinLock() : mux(portMUX_INITIALIZER_UNLOCKED) {}
+    void lock() { portENTER_CRITICAL(&mux); }
+    void unlock() { portEXIT_CRITICAL(&mux); }
+private:
+    portMUX_TYPE mux;
+#else
+    void lock() {}
+    void unlock() {}
+#endif
+};
+
+class SpinGuard {
+public:
+    explicit SpinGuard(SpinLock &l) : l(l) { l.lock(); }
+    ~SpinGuard() { l.unlock(); }
+    SpinGuard(const SpinGuard &) = delete;
+    SpinGuard &operator=(const SpinGuard &) = delete;
+private:
+    SpinLock &l;
+};
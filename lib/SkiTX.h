@@ -0,0 +1,171 @@
+/*
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+// -----------------------------------------------------------------------------
+// Transmit engine for messages TO roaster
+// A frame is a start pulse followed by every bit LSB first, each bit being a
+// LOW pulse (long = 1, short = 0) and a HIGH gap. The frame is encoded up front
+// into (low, high) pulse pairs and handed to the RMT peripheral, which plays it
+// out in the background while loop() keeps running.
+// -----------------------------------------------------------------------------
+
+// -----------------------------------------------------------------------------
+// Timing Constants (micros)
+// -----------------------------------------------------------------------------
+const int PULSE_ONE       = 1500;
+const int PULSE_ZERO      = 650;
+const int POST_PULSE_DELAY= 750;
+const int START_PULSE     = 7500;
+const int START_DELAY     = 3800;
+
+// -----------------------------------------------------------------------------
+// Symbol encoder
+// -----------------------------------------------------------------------------
+struct RoasterPulse {
+    uint16_t lowUs;   // line pulled LOW for this long
+    uint16_t highUs;  // then released HIGH for this long
+};
+
+const size_t TX_MAX_FRAME_BYTES = 8;
+const size_t TX_MAX_PULSES      = 1 + TX_MAX_FRAME_BYTES * 8; // start + bits
+
+// Encode buf into out[], returns number of pulses written (0 if it won't fit)
+size_t encodeRoasterFrame(const uint8_t *buf, size_t len, RoasterPulse *out, size_t maxPulses) {
+    size_t needed = 1 + len * 8;
+    if (needed > maxPulses) return 0;
+
+    size_t n = 0;
+    out[n].lowUs  = START_PULSE;
+    out[n].highUs = START_DELAY;
+    n++;
+
+    for (size_t i = 0; i < len; i++) {
+        for (uint8_t j = 0; j < 8; j++) {
+            out[n].lowUs  = ((buf[i] >> j) & 0x01) ? PULSE_ONE : PULSE_ZERO;
+            out[n].highUs = POST_PULSE_DELAY;
+            n++;
+        }
+    }
+    return n;
+}
+
+// Time on the wire for an encoded frame
+uint32_t roasterFrameDurationUs(const RoasterPulse *pulses, size_t count) {
+    uint32_t total = 0;
+    for (size_t i = 0; i < count; i++) total += pulses[i].lowUs + pulses[i].highUs;
+    return total;
+}
+
+// -----------------------------------------------------------------------------
+// Background transmitter
+// Uses RMT where the chip has it. Otherwise (or with SERIAL_DEBUG on, where the
+// pins are bogus) it falls back to the old blocking bit-bang.
+// -----------------------------------------------------------------------------
+#if defined(SOC_RMT_SUPPORTED) && SERIAL_DEBUG == 0
+#define SKI_TX_USE_RMT 1
+#else
+#define SKI_TX_USE_RMT 0
+#endif
+
+class RoasterTx {
+public:
+    typedef void (*CompleteCallback)(uint32_t durationUs);
+
+    RoasterTx() : pin(-1), inFlight(false), frameUs(0), sent(0), callback(nullptr) {}
+
+    void begin(int pin);
+    bool send(const uint8_t *buf, size_t len); // false until the last frame has been poll()ed
+    bool busy();                               // frame on the wire
+    void poll();                               // call from loop(), fires completion callback
+
+    void onComplete(CompleteCallback cb) { callback = cb; }
+    uint32_t framesSent() const { return sent; }
+    uint32_t lastFrameUs() const { return frameUs; }
+
+private:
+    int pin;
+    bool inFlight;
+    uint32_t frameUs;
+    uint32_t sent;
+    CompleteCallback callback;
+
+    RoasterPulse pulses[TX_MAX_PULSES];
+#if SKI_TX_USE_RMT
+    rmt_data_t symbols[TX_MAX_PULSES]; // owned by RMT until the frame completes
+#endif
+};
+
+void RoasterTx::begin(int pin) {
+    this->pin = pin;
+#if SKI_TX_USE_RMT
+    // 1 tick = 1us, line idles HIGH between frames
+    if (!rmtInit(pin, RMT_TX_MODE, RMT_MEM_NUM_BLOCKS_1, 1000000)) {
+        D_println("RMT TX init failed!");
+    }
+    rmtSetEOT(pin, HIGH);
+#endif
+}
+
+bool RoasterTx::busy() {
+#if SKI_TX_USE_RMT
+    return inFlight && !rmtTransmitCompleted(pin);
+#else
+    return false;
+#endif
+}
+
+bool RoasterTx::send(const uint8_t *buf, size_t len) {
+    if (inFlight) return false; // buffers still belong to the last frame
+
+    size_t count = encodeRoasterFrame(buf, len, pulses, TX_MAX_PULSES);
+    if (count == 0) return false;
+    frameUs = roasterFrameDurationUs(pulses, count);
+
+#if SKI_TX_USE_RMT
+    for (size_t i = 0; i < count; i++) {
+        symbols[i].level0    = LOW;
+        symbols[i].duration0 = pulses[i].lowUs;
+        symbols[i].level1    = HIGH;
+        symbols[i].duration1 = pulses[i].highUs;
+    }
+    if (!rmtWriteAsync(pin, symbols, count)) {
+        D_println("RMT TX write failed!");
+        return false;
+    }
+#else
+    for (size_t i = 0; i < count; i++) {
+      #if SERIAL_DEBUG == 0
+        digitalWrite(pin, LOW);
+        delayMicroseconds(pulses[i].lowUs);
+        digitalWrite(pin, HIGH);
+      #else
+        delayMicroseconds(pulses[i].lowUs);
+      #endif
+        delayMicroseconds(pulses[i].highUs);
+    }
+#endif
+
+    inFlight = true;
+    return true;
+}
+
+void RoasterTx::poll() {
+    if (!inFlight || busy()) return;
+    inFlight = false;
+    sent++;
+    if (callback) callback(frameUs);
+}
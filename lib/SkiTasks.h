@@ -0,0 +1,467 @@
+/*
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+// -----------------------------------------------------------------------------
+// Work split
+//   io           roaster RX pickup and the frame scheduler, every tick. Highest
+//                priority; on dual-core parts pinned to the core NimBLE's host
+//                task isn't on.
+//   control      filter, commands (BLE and wired), PID, replies and telemetry. Wakes on
+//                a new sample or command, and at least every CONTROL_PERIOD_MS.
+//   housekeeping LED, flash writes (roast log, PID config), log downloads,
+//                load figures.
+//                Lowest priority.
+//
+// io hands bean temperatures to control through a bounded queue and a task
+// notification; control hands frames back through FrameScheduler's fields.
+// With SKI_TASKS off (host build, or -D SKI_TASKS=0) loop() calls the three
+// steps in the same order instead, and single-core parts like the C6 simply
+// get the tasks unpinned, relying on their priorities.
+// -----------------------------------------------------------------------------
+
+extern SkyRoasterParser roaster;
+extern RoasterTx roasterTx;
+extern PIDConfig myPIDConfig;
+extern FrameScheduler frameScheduler;
+extern TempFilter tempFilter;
+extern double temp;
+extern char CorF;
+
+const uint32_t CONTROL_PERIOD_MS      = 5;
+const uint32_t HOUSEKEEPING_PERIOD_MS = 50;
+const uint32_t TASK_STATS_WINDOW_MS   = 1000;
+const size_t   SAMPLE_QUEUE_DEPTH     = 8;
+
+#if SKI_TASKS
+const UBaseType_t IO_TASK_PRIORITY      = 6;
+const UBaseType_t CONTROL_TASK_PRIORITY = 5;
+const UBaseType_t HK_TASK_PRIORITY      = 1;
+const uint32_t IO_TASK_STACK      = 3072;
+const uint32_t CONTROL_TASK_STACK = 6144;
+const uint32_t HK_TASK_STACK      = 3072;
+
+#if defined(CONFIG_FREERTOS_UNICORE) || portNUM_PROCESSORS == 1
+#define SKI_PIN_TASKS 0
+#else
+#define SKI_PIN_TASKS 1
+#ifdef CONFIG_BT_NIMBLE_PINNED_TO_CORE
+const BaseType_t IO_TASK_CORE = CONFIG_BT_NIMBLE_PINNED_TO_CORE ? 0 : 1;
+#else
+const BaseType_t IO_TASK_CORE = 1;
+#endif
+#endif
+#endif
+
+// -----------------------------------------------------------------------------
+// Bean temperature hand-off, io -> control
+// -----------------------------------------------------------------------------
+struct TempSample {
+    int32_t centiC;
+    uint32_t ms;
+};
+
+class SampleQueue {
+public:
+    void begin() {
+#if SKI_TASKS
+        q = xQueueCreate(SAMPLE_QUEUE_DEPTH, sizeof(TempSample));
+#endif
+    }
+
+    bool post(const TempSample &s) {
+#if SKI_TASKS
+        if (q && xQueueSend(q, &s, 0) == pdTRUE) return true;
+#else
+        if (count < SAMPLE_QUEUE_DEPTH) {
+            buf[(head + count++) % SAMPLE_QUEUE_DEPTH] = s;
+            return true;
+        }
+#endif
+        dropped++;
+        return false;
+    }
+
+    bool take(TempSample &s) {
+#if SKI_TASKS
+        return q && xQueueReceive(q, &s, 0) == pdTRUE;
+#else
+        if (count == 0) return false;
+        s = buf[head];
+        head = (head + 1) % SAMPLE_QUEUE_DEPTH;
+        count--;
+        return true;
+#endif
+    }
+
+    uint32_t dropped = 0;
+
+private:
+#if SKI_TASKS
+    QueueHandle_t q = nullptr;
+#else
+    TempSample buf[SAMPLE_QUEUE_DEPTH];
+    size_t head = 0;
+    size_t count = 0;
+#endif
+};
+
+SampleQueue sampleQueue;
+
+// -----------------------------------------------------------------------------
+// Self-accounting runtime stats
+// Each step is timed with micros(); housekeeping turns the busy time into a
+// load figure once per TASK_STATS_WINDOW_MS. Works the same without tasks.
+// -----------------------------------------------------------------------------
+struct TaskStats {
+    const char *name;
+    uint32_t runs;
+    uint64_t busyUs;
+    uint32_t maxStepUs;
+    uint64_t windowBusyUs;     // busyUs at the start of the window
+    uint16_t loadPermille;     // last window
+    uint32_t stackFree;        // bytes, 0 if unknown
+};
+
+enum TaskId { TASK_IO, TASK_CONTROL, TASK_HOUSEKEEPING, TASK_COUNT };
+
+TaskStats taskStats[TASK_COUNT] = {
+    { "io",  0, 0, 0, 0, 0, 0 },
+    { "ctl", 0, 0, 0, 0, 0, 0 },
+    { "hk",  0, 0, 0, 0, 0, 0 },
+};
+unsigned long taskStatsWindowMs = 0;
+
+#if SKI_TASKS
+TaskHandle_t taskHandles[TASK_COUNT] = { nullptr, nullptr, nullptr };
+#endif
+
+template <typename Step>
+void runTimed(TaskId id, Step step) {
+    unsigned long start = micros();
+    step();
+    uint32_t took = micros() - start;
+    TaskStats &s = taskStats[id];
+    s.runs++;
+    s.busyUs += took;
+    if (took > s.maxStepUs) s.maxStepUs = took;
+}
+
+void updateTaskStats() {
+    unsigned long now = millis();
+    unsigned long elapsed = now - taskStatsWindowMs;
+    if (elapsed < TASK_STATS_WINDOW_MS) return;
+    taskStatsWindowMs = now;
+
+    for (int i = 0; i < TASK_COUNT; i++) {
+        TaskStats &s = taskStats[i];
+        uint64_t busy = s.busyUs - s.windowBusyUs;
+        s.windowBusyUs = s.busyUs;
+        uint64_t permille = busy / elapsed;  // us busy per ms
+        s.loadPermille = permille > 1000 ? 1000 : permille;
+#if SKI_TASKS
+        if (taskHandles[i]) s.stackFree = uxTaskGetStackHighWaterMark(taskHandles[i]);
+#endif
+    }
+}
+
+// "# TASKS io 0.4% 85us 1840 ctl ..." - load, longest step, free stack bytes
+int formatTaskStats(char *buf, size_t len) {
+    int n = snprintf(buf, len, "# TASKS");
+    for (int i = 0; i < TASK_COUNT && n > 0 && (size_t)n < len; i++) {
+        const TaskStats &s = taskStats[i];
+        n += snprintf(buf + n, len - n, " %s %u.%u%% %luus %lu", s.name, s.loadPermille / 10,
+                      s.loadPermille % 10, (unsigned long)s.maxStepUs, (unsigned long)s.stackFree);
+    }
+    if (n > 0 && (size_t)n < len - 1) { buf[n++] = '\n'; buf[n] = '\0'; }
+    return n < (int)len ? n : (int)len - 1;
+}
+
+// -----------------------------------------------------------------------------
+// Diagnostics glue: counters that live in other modules, see SkiDiag.h
+// -----------------------------------------------------------------------------
+uint32_t sampleBatchMax = 0;      // control task
+uint32_t txFramesBase = 0;
+uint32_t cmdDroppedBase = 0;
+uint32_t sampleDroppedBase = 0;
+uint32_t notifyDroppedBase = 0;
+uint32_t rxAbortedBase = 0;
+uint32_t rxOverrunBase = 0;
+
+// over every transport
+uint32_t commandsDropped() {
+    uint32_t n = 0;
+    for (size_t i = 0; i < transportCount; i++) {
+        CommandRing& ring = transports[i]->commands();
+        n += ring.overflows() + ring.oversized() + transports[i]->inputDropped;
+    }
+    return n;
+}
+
+uint32_t commandRingMax() {
+    uint32_t n = 0;
+    for (size_t i = 0; i < transportCount; i++) n = max(n, (uint32_t)transports[i]->commands().highWaterMark());
+    return n;
+}
+
+void diagnosticsReset() {
+    diag.reset();
+    sampleBatchMax = 0;
+    notifyQueue.maxDepth = 0;
+    for (size_t i = 0; i < transportCount; i++) transports[i]->commands().resetHighWater();
+    txFramesBase = frameScheduler.framesSent();
+    cmdDroppedBase = commandsDropped();
+    sampleDroppedBase = sampleQueue.dropped;
+    notifyDroppedBase = notifyQueue.dropped;
+    rxAbortedBase = roaster.framesAborted();
+    rxOverrunBase = roaster.framesOverrun();
+}
+
+size_t diagnosticsBlob(uint8_t *out) {
+    uint32_t counters[DIAG_COUNTER_COUNT];
+    counters[DIAG_RX_FRAMES]        = diag.rxFrameCount();
+    counters[DIAG_RX_PER_S]         = diag.rxPerSecond();
+    counters[DIAG_RX_BAD_CHECKSUM]  = diag.rxBadCount();
+    counters[DIAG_TX_FRAMES]        = frameScheduler.framesSent() - txFramesBase;
+    counters[DIAG_CMD_RING_MAX]     = commandRingMax();
+    counters[DIAG_CMD_RING_DROPPED] = commandsDropped() - cmdDroppedBase;
+    counters[DIAG_SAMPLE_BATCH_MAX] = sampleBatchMax;
+    counters[DIAG_SAMPLE_DROPPED]   = sampleQueue.dropped - sampleDroppedBase;
+    counters[DIAG_NOTIFY_MAX]       = notifyQueue.maxDepth;
+    counters[DIAG_NOTIFY_DROPPED]   = notifyQueue.dropped - notifyDroppedBase;
+    counters[DIAG_RX_ABORTED]       = roaster.framesAborted() - rxAbortedBase;
+    counters[DIAG_RX_OVERRUN]       = roaster.framesOverrun() - rxOverrunBase;
+
+    uint8_t *p = out;
+    *p++ = DIAG_VERSION;
+    *p++ = DIAG_HIST_COUNT;
+    *p++ = DIAG_BUCKETS;
+    *p++ = DIAG_COUNTER_COUNT;
+    putLE32(p, diag.msSinceReset()); p += 4;
+    for (int i = 0; i < DIAG_COUNTER_COUNT; i++, p += 4) putLE32(p, counters[i]);
+    for (int h = 0; h < DIAG_HIST_COUNT; h++) {
+        const DiagHistogram &hist = diag.histogram((DiagHist)h);
+        bool current = diag.histogramCurrent((DiagHist)h);   // not recorded since a reset: empty
+        putLE32(p, current ? hist.max() : 0); p += 4;
+        for (uint8_t b = 0; b < DIAG_BUCKETS; b++, p += 4) putLE32(p, current ? hist.bucket(b) : 0);
+    }
+    return p - out;
+}
+
+// "# DIAG rx 6.7/s bad 0 w>p 63/120us c>f 131071/182000us ..." - p99 bucket top / max
+int formatDiagnostics(char *buf, size_t len) {
+    static const char *const names[DIAG_HIST_COUNT] = { "w>p", "c>f", "tx", "io", "ntf" };
+    int n = snprintf(buf, len, "# DIAG rx %lu/s bad %lu", (unsigned long)diag.rxPerSecond(),
+                     (unsigned long)diag.rxBadCount());
+    for (int h = 0; h < DIAG_HIST_COUNT && n > 0 && (size_t)n < len; h++) {
+        const DiagHistogram &hist = diag.histogram((DiagHist)h);
+        bool current = diag.histogramCurrent((DiagHist)h);
+        n += snprintf(buf + n, len - n, " %s %lu/%luus", names[h],
+                      (unsigned long)(current ? hist.percentileUs(99) : 0), (unsigned long)(current ? hist.max() : 0));
+    }
+    if (n > 0 && (size_t)n < len - 1) { buf[n++] = '\n'; buf[n] = '\0'; }
+    return n < (int)len ? n : (int)len - 1;
+}
+
+// "# RX ADAPT S 6562-10000 0<905 1 1202-2010 c 650/1500/7500 abort 0.4% (3/750) bad 0 recal 2 fifo 1/8 ovr 0"
+int formatRxCalibration(char *buf, size_t len) {
+    const RoasterPulseDecoder &d = roaster.pulseDecoder();
+    const RxWindows &w = d.windows();
+    uint32_t started = d.framesComplete() + d.framesAborted();
+    int n = snprintf(buf, len, "# RX %s S %u-%u 0<%u 1 %u-%u c %u/%u/%u abort %.1f%% (%lu/%lu) bad %lu recal %lu"
+                     " fifo %lu/%u ovr %lu\n",
+                     d.isAdaptive() ? "ADAPT" : "FIXED", w.startMin, w.startMax, w.bit0Max, w.bit1Min, w.bit1Max,
+                     d.bit0Center(), d.bit1Center(), d.startCenter(),
+                     started ? 100.0 * d.framesAborted() / started : 0.0, (unsigned long)d.framesAborted(),
+                     (unsigned long)started, (unsigned long)d.framesBadChecksum(), (unsigned long)d.recalibrations(),
+                     (unsigned long)roaster.framesQueuedMax(), (unsigned)RX_FRAME_SLOTS,
+                     (unsigned long)roaster.framesOverrun());
+    return n < (int)len ? n : (int)len - 1;
+}
+
+void rxSetAdaptive(bool on) { roaster.setAdaptive(on); }
+void rxResetCalibration() { roaster.resetCalibration(); }
+
+// -----------------------------------------------------------------------------
+// Wake-ups
+// -----------------------------------------------------------------------------
+void wakeControlTask() {
+#if SKI_TASKS
+    if (taskHandles[TASK_CONTROL]) xTaskNotifyGive(taskHandles[TASK_CONTROL]);
+#endif
+}
+
+// -----------------------------------------------------------------------------
+// Steps
+// -----------------------------------------------------------------------------
+void ioStep() {
+    diag.ioTick();
+
+    // learn the pulse windows here, the edge ISR only counts pulses
+    roaster.calibrate();
+
+    // drain every roaster frame that came in since the last step, oldest
+    // first, validate and pass the temps on stamped with when they arrived
+    uint8_t msg[7];
+    uint32_t stampUs;
+    while (roaster.getMessage(msg, &stampUs)) {
+        if (roaster.validate(msg)) {
+            diag.rxFrame();
+            uint32_t ageMs = (micros() - stampUs) / 1000;
+            TempSample s = { roaster.getTemperatureFixed(msg).centiC, (uint32_t)millis() - ageMs };
+            if (sampleQueue.post(s)) wakeControlTask();
+        } else {
+            diag.rxBadChecksum();
+            D_println("Checksum failed!");
+        }
+    }
+
+    // send changed fields (or a heartbeat) to roaster
+    frameScheduler.service();
+}
+
+void controlStep() {
+    // roaster shut down, clear our buffers
+    if (itsbeentoolong()) { shutdown(); }
+
+    TempSample s;
+    uint32_t batch = 0;
+    while (sampleQueue.take(s)) {
+        tempFilter.add(s.centiC, s.ms);
+        temp = tempFilter.temperature(CorF);
+        batch++;
+    }
+    if (batch > sampleBatchMax) sampleBatchMax = batch;
+
+    // process incoming commands from every transport, could be read or write
+    for (size_t i = 0; i < transportCount; i++) {
+        CommandTransport& t = *transports[i];
+        t.poll();
+        CommandRing& ring = t.commands();
+        while (CommandRing::Slot* cmd = ring.front()) {
+            replyTransport = &t;           // replies go back the way it came
+            lastEventTime = micros();      // the watchdog only counts real commands, see SkiCMD.h
+            commandWriteUs = cmd->stampUs; // replies are spaced from the write
+            diag.record(DIAG_WRITE_TO_PARSE, micros() - cmd->stampUs);
+            frameScheduler.setOrigin(cmd->stampUs);  // for the write -> frame figure
+            executeCommandBatch(cmd->data, cmd->len);  // process the command(s) in place
+            frameScheduler.setOrigin(0);
+            ring.pop(); //remove it from the ring
+        }
+    }
+    replyTransport = nullptr;
+
+    // move the setpoint and vent along the profile, if one is running
+    profileRunner.service();
+
+    // drive the relay if an autotune is running
+    autotune.service();
+
+    // tunings staged by the BLE PID characteristics
+    myPIDConfig.applyIfChanged(myPID);
+
+    // Ensure PID or manual heat control is handled
+    handlePIDControl();
+
+    // append to the roast log
+    recorder.sample();
+
+    // CAPTURE;DUMP, a few replies at a time
+    serviceCaptureDump();
+
+    // send any replies that are due
+    serviceTransports();
+
+    // push telemetry if a client asked for it
+    serviceTelemetry();
+}
+
+void housekeepingStep() {
+    // update the led so user knows we're running
+    handleLED();
+
+    // roast log to flash a step per gap io leaves between roaster frames
+    if (recorder.flushDue() && frameScheduler.quietWindow()) {
+        recorder.flushStep();
+        frameScheduler.endQuiet();
+    }
+
+    // save PID tunings once they settle, in a gap of their own
+    if (myPIDConfig.commitDue() && frameScheduler.quietWindow()) {
+        myPIDConfig.commit();
+        frameScheduler.endQuiet();
+    }
+
+    // log downloads
+    recorder.service();
+
+    // short connection interval while roasting, relaxed between roasts
+    linkManager.service(frameScheduler.get(HEAT_BYTE) || frameScheduler.get(DRUM_BYTE));
+
+    diag.service();
+    updateTaskStats();
+}
+
+// -----------------------------------------------------------------------------
+// Tasks
+// -----------------------------------------------------------------------------
+#if SKI_TASKS
+void ioTask(void *) {
+    TickType_t last = xTaskGetTickCount();
+    for (;;) {
+        runTimed(TASK_IO, ioStep);
+        vTaskDelayUntil(&last, 1);
+    }
+}
+
+void controlTask(void *) {
+    for (;;) {
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(CONTROL_PERIOD_MS));
+        runTimed(TASK_CONTROL, controlStep);
+    }
+}
+
+void housekeepingTask(void *) {
+    for (;;) {
+        runTimed(TASK_HOUSEKEEPING, housekeepingStep);
+        vTaskDelay(pdMS_TO_TICKS(HOUSEKEEPING_PERIOD_MS));
+    }
+}
+#endif
+
+void startTasks() {
+    sampleQueue.begin();
+    taskStatsWindowMs = millis();
+#if SKI_TASKS
+    xTaskCreate(controlTask, "ski-ctl", CONTROL_TASK_STACK, nullptr, CONTROL_TASK_PRIORITY,
+                &taskHandles[TASK_CONTROL]);
+    xTaskCreate(housekeepingTask, "ski-hk", HK_TASK_STACK, nullptr, HK_TASK_PRIORITY,
+                &taskHandles[TASK_HOUSEKEEPING]);
+#if SKI_PIN_TASKS
+    xTaskCreatePinnedToCore(ioTask, "ski-io", IO_TASK_STACK, nullptr, IO_TASK_PRIORITY,
+                            &taskHandles[TASK_IO], IO_TASK_CORE);
+#else
+    xTaskCreate(ioTask, "ski-io", IO_TASK_STACK, nullptr, IO_TASK_PRIORITY, &taskHandles[TASK_IO]);
+#endif
+#endif
+}
+
+// One pass of everything, for loop() when there are no tasks
+void runSteps() {
+    runTimed(TASK_IO, ioStep);
+    runTimed(TASK_CONTROL, controlStep);
+    runTimed(TASK_HOUSEKEEPING, housekeepingStep);
+}
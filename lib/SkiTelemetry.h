@@ -0,0 +1,94 @@
+/*
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+// -----------------------------------------------------------------------------
+// Push telemetry on the TELEMETRY characteristic
+// The client writes a uint16 LE period in ms (0 stops the stream) and gets a
+// packed little-endian sample notified at that rate - no polling, no ASCII.
+// The TC4 READ command keeps working alongside it.
+//
+// Packet, version 3 (19 bytes, fits the default 20 byte ATT payload). v3
+// keeps the v2 layout but the temperatures are always °C, since °F x100
+// doesn't fit an int16 past 327 °F; bit1 only says what the user shows:
+//   0  uint8   version
+//   1  uint8   flags: bit0 PID automatic, bit1 display in F, bit2 profile running
+//   2  uint16  sequence number
+//   4  uint32  device time, ms
+//   8  int16   bean temp °C x100 (filtered)
+//  10  uint8   heat %
+//  11  uint8   vent %
+//  12  uint8   drum %
+//  13  uint8   cool %
+//  14  int16   PID setpoint °C x100
+//  16  uint8   PID output %
+//  17  int16   rate of rise °C/min x100
+// -----------------------------------------------------------------------------
+
+const uint8_t  TELEMETRY_VERSION      = 3;
+const uint8_t  TELEMETRY_BYTES        = 19;
+const uint16_t TELEMETRY_MIN_PERIOD_MS = 50;
+
+volatile uint16_t telemetryPeriodMs = 0; // written from the BLE callback
+unsigned long telemetryLastMs = 0;
+uint16_t telemetrySeq = 0;
+
+void setTelemetryPeriod(uint16_t periodMs) {
+    if (periodMs != 0 && periodMs < TELEMETRY_MIN_PERIOD_MS) periodMs = TELEMETRY_MIN_PERIOD_MS;
+    telemetryPeriodMs = periodMs;
+}
+
+void putLE16(uint8_t *p, uint16_t v) { p[0] = v; p[1] = v >> 8; }
+void putLE32(uint8_t *p, uint32_t v) { p[0] = v; p[1] = v >> 8; p[2] = v >> 16; p[3] = v >> 24; }
+
+// current units -> °C
+double toCelsius(double v) { return CorF == 'F' ? (v - 32.0) * 5.0 / 9.0 : v; }
+
+int16_t toCenti(double v) {
+    double c = v * 100.0;
+    if (c > 32767) return 32767;
+    if (c < -32768) return -32768;
+    return (int16_t)std::lround(c);
+}
+
+void buildTelemetry(uint8_t *pkt, uint32_t nowMs) {
+    bool automatic = (myPID.GetMode() == AUTOMATIC);
+
+    pkt[0] = TELEMETRY_VERSION;
+    pkt[1] = (automatic ? 0x01 : 0) | (CorF == 'F' ? 0x02 : 0) | (profileRunner.running() ? 0x04 : 0);
+    putLE16(&pkt[2], telemetrySeq++);
+    putLE32(&pkt[4], nowMs);
+    putLE16(&pkt[8], toCenti(toCelsius(temp)));
+    pkt[10] = frameScheduler.get(HEAT_BYTE);
+    pkt[11] = frameScheduler.get(VENT_BYTE);
+    pkt[12] = frameScheduler.get(DRUM_BYTE);
+    pkt[13] = frameScheduler.get(COOL_BYTE);
+    putLE16(&pkt[14], toCenti(toCelsius(pSetpoint)));
+    pkt[16] = automatic ? (uint8_t)constrain(std::lround(pOutput), 0L, 100L) : frameScheduler.get(HEAT_BYTE);
+    putLE16(&pkt[17], toCenti(tempFilter.rateOfRise('C')));
+}
+
+void serviceTelemetry() {
+    uint16_t period = telemetryPeriodMs;
+    if (period == 0 || !pTelemetryCharacteristic || !sessions.subscribed(SUB_TELEMETRY)) return;
+
+    unsigned long now = millis();
+    if (now - telemetryLastMs < period) return;
+    telemetryLastMs = now;
+
+    uint8_t pkt[TELEMETRY_BYTES];
+    buildTelemetry(pkt, now);
+    pTelemetryCharacteristic->setValue(pkt, TELEMETRY_BYTES);
+    pTelemetryCharacteristic->notify();   // built once, to every subscriber
+}
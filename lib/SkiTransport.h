@@ -0,0 +1,251 @@
+/*
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#pragma once
+
+// -----------------------------------------------------------------------------
+// Command transports
+// The TC4 command set in SkiCMD.h doesn't care where a line came from. Each
+// transport owns a CommandRing its input lands in and a reply() for what the
+// handlers send back; controlStep() drains every registered transport in turn
+// and replies go to the transport the running command came from.
+//
+//   BleTransport     HiBean's RX/TX characteristics, replies spaced by the
+//                    notify queue (SkiBLE.h)
+//   StreamTransport  a wired port, e.g. USB CDC for Artisan's TC4 driver.
+//                    Lines end in '\n' or '\r', replies are written straight
+//                    back with no spacing and no airtime limit
+//   PipeTransport    in memory, for driving the engine from host tests
+//
+// BLE is always there; others are registered from setup() before the tasks
+// start. A wired port sits outside the BLE session roles: whoever holds the
+// cable is trusted like the controller.
+// -----------------------------------------------------------------------------
+
+const size_t MAX_TRANSPORTS = 4;
+
+// Commands over the USB serial port, -D SKI_SERIAL_CMD=0/1 to force it. On by
+// default where Serial is the native USB CDC port (C6); it shares the port
+// with SERIAL_DEBUG output, so debug builds leave it off.
+#ifndef SKI_SERIAL_CMD
+#if ARDUINO_USB_CDC_ON_BOOT && !SERIAL_DEBUG && !SKI_BENCH
+#define SKI_SERIAL_CMD 1
+#else
+#define SKI_SERIAL_CMD 0
+#endif
+#endif
+
+class CommandTransport {
+public:
+    explicit CommandTransport(const char* name) : transportName(name) {}
+
+    const char* name() const { return transportName; }
+
+    virtual CommandRing& commands() = 0;
+    virtual void poll() {}        // control task, before the ring is drained
+    virtual void reply(const char* msg, size_t len, NotifyKind kind) = 0;
+    virtual void service() {}     // control task, after the commands ran
+
+    // --- Stats ---
+    uint32_t replies = 0;
+    uint32_t repliesDropped = 0;
+    uint32_t inputDropped = 0;    // lines lost before they reached the ring
+
+private:
+    const char* transportName;
+};
+
+// -----------------------------------------------------------------------------
+// BLE
+// -----------------------------------------------------------------------------
+class BleTransport : public CommandTransport {
+public:
+    BleTransport() : CommandTransport("BLE") {}
+
+    CommandRing& commands() override { return commandRing; }
+
+    void reply(const char* msg, size_t len, NotifyKind kind) override {
+        if (notifyNimBLEClient(msg, len, kind)) replies++;
+        else repliesDropped++;
+    }
+
+    void service() override { notifyQueue.service(); }
+};
+
+// -----------------------------------------------------------------------------
+// Any Arduino Stream, read without blocking from the control task
+// -----------------------------------------------------------------------------
+class StreamTransport : public CommandTransport {
+public:
+    StreamTransport(const char* name, Stream& port) : CommandTransport(name), port(port) {}
+
+    CommandRing& commands() override { return ring; }
+
+    void poll() override {
+        bool queued = false;
+        while (port.available() > 0) {
+            int c = port.read();
+            if (c < 0) break;
+            if (c == '\n' || c == '\r') {
+                if (lineLen > 0 && !discarding) {
+                    if (ring.push(line, lineLen, micros())) queued = true;
+                }
+                lineLen = 0;
+                discarding = false;
+            } else if (discarding) {
+                continue;
+            } else if (lineLen + 1 < CMD_SLOT_BYTES) {
+                line[lineLen++] = (char)c;
+            } else {
+                inputDropped++;   // too long for a slot, drop it whole
+                discarding = true;
+            }
+        }
+        if (queued) wakeControlTask();
+    }
+
+    // never block the control task on a host that stopped reading
+    void reply(const char* msg, size_t len, NotifyKind) override {
+        if (port.availableForWrite() < (int)len) { repliesDropped++; return; }
+        port.write((const uint8_t*)msg, len);
+        replies++;
+    }
+
+private:
+    Stream& port;
+    CommandRing ring;
+    char line[CMD_SLOT_BYTES];
+    size_t lineLen = 0;
+    bool discarding = false;
+};
+
+// -----------------------------------------------------------------------------
+// In-memory pipe
+// send() from one task, read() replies from the same one; the control task
+// is the other end of both rings.
+// -----------------------------------------------------------------------------
+class PipeTransport : public CommandTransport {
+public:
+    typedef SpscRing<NOTIFY_SLOT_BYTES, 8> ReplyRing;
+
+    PipeTransport() : CommandTransport("PIPE") {}
+
+    CommandRing& commands() override { return ring; }
+
+    bool send(const char* line, size_t len) {
+        while (len > 0 && (line[len - 1] == '\n' || line[len - 1] == '\r')) len--;
+        if (len == 0) return false;
+        if (!ring.push(line, len, micros())) return false;
+        wakeControlTask();
+        return true;
+    }
+
+    void reply(const char* msg, size_t len, NotifyKind) override {
+        if (len >= NOTIFY_SLOT_BYTES) len = NOTIFY_SLOT_BYTES - 1;
+        if (out.push(msg, len, micros())) replies++;
+        else repliesDropped++;
+    }
+
+    // oldest reply into dst ('\0' terminated), 0 when there is none
+    size_t read(char* dst, size_t max) {
+        ReplyRing::Slot* s = out.front();
+        if (!s || max == 0) return 0;
+        size_t len = s->len < max - 1 ? s->len : max - 1;
+        memcpy(dst, s->data, len);
+        dst[len] = '\0';
+        out.pop();
+        return len;
+    }
+
+private:
+    CommandRing ring;
+    ReplyRing out;
+};
+
+// -----------------------------------------------------------------------------
+// Registry
+// -----------------------------------------------------------------------------
+BleTransport bleTransport;
+CommandTransport* transports[MAX_TRANSPORTS] = { &bleTransport };
+size_t transportCount = 1;
+CommandTransport* replyTransport = nullptr;   // where the running command came from
+
+#if SKI_SERIAL_CMD
+StreamTransport serialTransport("USB", Serial);
+#endif
+
+// setup() only, before the tasks start
+bool registerTransport(CommandTransport& t) {
+    if (transportCount == MAX_TRANSPORTS) return false;
+    transports[transportCount++] = &t;
+    return true;
+}
+
+void serviceTransports() {
+    for (size_t i = 0; i < transportCount; i++) transports[i]->service();
+}
+
+// -----------------------------------------------------------------------------
+// Replies
+// While a command batch runs, replies are gathered and go out as one reply
+// when it ends (or when the next one wouldn't fit). Control task only.
+// -----------------------------------------------------------------------------
+struct ReplyBatch {
+    bool open = false;
+    uint8_t parts = 0;
+    NotifyKind kind = NOTIFY_REPLY;
+    size_t len = 0;
+    char data[NOTIFY_SLOT_BYTES];
+};
+
+ReplyBatch replyBatch;
+
+void deliverReply(const char* message, size_t len, NotifyKind kind) {
+    CommandTransport* t = replyTransport ? replyTransport : &bleTransport;
+    t->reply(message, len, kind);
+}
+
+void flushReplyBatch() {
+    // a lone READ reply keeps its kind so a fresher one can still replace it
+    if (replyBatch.len) deliverReply(replyBatch.data, replyBatch.len, replyBatch.parts == 1 ? replyBatch.kind : NOTIFY_REPLY);
+    replyBatch.len = 0;
+    replyBatch.parts = 0;
+}
+
+void beginReplyBatch() {
+    replyBatch.open = true;
+    replyBatch.len = 0;
+    replyBatch.parts = 0;
+}
+
+void endReplyBatch() {
+    flushReplyBatch();
+    replyBatch.open = false;
+}
+
+// Answer the command being executed, on the transport it came in on
+void sendReply(const char* message, size_t len, NotifyKind kind = NOTIFY_REPLY) {
+    if (!replyBatch.open) {
+        deliverReply(message, len, kind);
+        return;
+    }
+    if (len > NOTIFY_SLOT_BYTES) len = NOTIFY_SLOT_BYTES;
+    if (replyBatch.len + len > NOTIFY_SLOT_BYTES) flushReplyBatch();
+    memcpy(replyBatch.data + replyBatch.len, message, len);
+    replyBatch.len += len;
+    replyBatch.kind = kind;
+    replyBatch.parts++;
+}
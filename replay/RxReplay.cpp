@@ -0,0 +1,328 @@
+/*
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+// -----------------------------------------------------------------------------
+// RX replay
+// Feeds roaster RX edge traces through the firmware's pulse decoder
+// (RoasterPulseDecoder in lib/SkiParser.h) and reports decoded frames,
+// checksum pass/fail and decode throughput as JSON lines. Traces are either a
+// CAPTURE;DUMP from a device (see lib/SkiCapture.h; monitor timestamps in
+// front of the lines are fine) or generated here with the roaster's timing
+// and some damage:
+//   --jitter-us N       every LOW and HIGH width stretched by up to +/-N us
+//   --glitch-pct P      P% of pulses get a 1-3 us spike of the other level
+//   --truncate-pct P    P% of frames stop after a random number of bits
+//   --stretch-pct P     every width P% longer (or shorter), like a unit whose
+//                       timing has drifted
+// Generated frames are known, so those runs also report how many came out
+// intact ("success"); --sweep-jitter MAX[:STEP] repeats the run for each
+// jitter from 0 to MAX.
+//
+// The line is conditioned like the default RMT backend: --filter-us N drops
+// spikes shorter than N us (RMT glitch filter, default 2) and --idle-us N
+// resets the decoder after a HIGH gap that long (end of an RMT capture,
+// default 12000). 0 turns either off, which is the GPIO interrupt backend.
+// The decoder learns its pulse windows as on the device; --fixed keeps the
+// default windows, for comparison.
+//
+//   pio run -e native-replay
+//   .pio/build/native-replay/program --trace capture.txt
+//   .pio/build/native-replay/program --frames 2000 --glitch-pct 1 --sweep-jitter 400:50
+//   .pio/build/native-replay/program --frames 100 --jitter-us 150 --write trace.txt
+// -----------------------------------------------------------------------------
+
+#include <Arduino.h>
+#include "../lib/SerialDebug.h"
+#include "../lib/SkiCapture.h"
+#include "../lib/SkiParser.h"
+#include <chrono>
+#include <random>
+#include <string>
+#include <vector>
+
+char CorF = 'C';
+
+namespace {
+
+typedef RoasterPulseDecoder Decoder;
+typedef std::vector<uint8_t> Frame;
+
+// Roaster wire timing (as in sim/SimRoaster.cpp)
+const uint32_t START_LOW_US  = 7500;
+const uint32_t START_HIGH_US = 3800;
+const uint32_t BIT0_LOW_US   = 650;
+const uint32_t BIT1_LOW_US   = 1500;
+const uint32_t BIT_HIGH_US   = 750;
+const uint32_t FRAME_PERIOD_US = 250000;
+
+struct Edge {
+    uint8_t level;
+    uint32_t us;       // 31 bits, as captured
+};
+
+struct Segment {
+    uint8_t level;
+    uint32_t us;       // how long the line stayed there
+};
+
+struct Options {
+    uint32_t jitterUs = 0;
+    double glitchPct = 0;
+    double truncatePct = 0;
+    double stretchPct = 0;
+    bool adaptive = true;
+    uint32_t filterUs = 2;
+    uint32_t idleUs = 12000;
+    uint32_t frames = 1000;
+    uint32_t seed = 1;
+    uint32_t repeat = 20;     // decode passes for the throughput figure
+};
+
+struct Result {
+    size_t pulses = 0;
+    size_t frames = 0;
+    size_t checksumOk = 0;
+    size_t checksumBad = 0;
+    size_t intact = 0;        // generated traces: matches a frame that was sent
+    double nsPerPulse = 0;
+    RoasterPulseDecoder decoder;   // as it ended up
+};
+
+// -----------------------------------------------------------------------------
+// Traces
+// -----------------------------------------------------------------------------
+
+// "<level>,<us>" per edge, anything before the level (monitor timestamps) and
+// "#" lines ignored
+bool loadTrace(const char *path, std::vector<Edge> &edges) {
+    FILE *f = fopen(path, "r");
+    if (!f) return false;
+    char line[160];
+    while (fgets(line, sizeof(line), f)) {
+        if (strchr(line, '#')) continue;
+        // the edge is the last thing on the line: " <0|1>,<digits>"
+        char *comma = strrchr(line, ',');
+        if (!comma || comma == line) continue;
+        char level = comma[-1];
+        if (level != '0' && level != '1') continue;
+        if (comma - 1 > line && comma[-2] != ' ' && comma[-2] != '>') continue;
+        char *end;
+        unsigned long us = strtoul(comma + 1, &end, 10);
+        if (end == comma + 1 || strspn(end, " \r\n") != strlen(end)) continue;
+        edges.push_back({ (uint8_t)(level - '0'), (uint32_t)us & RX_CAPTURE_US_MASK });
+    }
+    fclose(f);
+    return true;
+}
+
+bool writeTrace(const char *path, const std::vector<Edge> &edges) {
+    FILE *f = fopen(path, "w");
+    if (!f) return false;
+    fprintf(f, "# rxcapture v1 edges=%zu\n", edges.size());
+    for (const Edge &e : edges) fprintf(f, "%u,%lu\n", e.level, (unsigned long)e.us);
+    fprintf(f, "# end\n");
+    fclose(f);
+    return true;
+}
+
+// A plausible bean temp frame: X reading, checksum last
+Frame randomFrame(std::mt19937 &rng) {
+    uint16_t rawX = 200 + rng() % 637;
+    Frame f = { (uint8_t)(rawX >> 8), (uint8_t)rawX, 0, 0, 0, 0, 0 };
+    for (int i = 0; i < Decoder::MSG_BYTES - 1; i++) f[Decoder::MSG_BYTES - 1] += f[i];
+    return f;
+}
+
+std::vector<Edge> generateTrace(const Options &o, std::vector<Frame> &sent) {
+    std::mt19937 rng(o.seed);
+    std::uniform_real_distribution<double> pct(0, 100);
+    std::vector<Edge> edges;
+    uint32_t at = 0;
+
+    auto jitter = [&](uint32_t us) -> uint32_t {
+        us = (uint32_t)(us * (100 + o.stretchPct) / 100);
+        if (!o.jitterUs) return us;
+        int32_t j = (int32_t)(rng() % (2 * o.jitterUs + 1)) - (int32_t)o.jitterUs;
+        return (int32_t)us + j > 1 ? us + j : 1;
+    };
+    // level for us, maybe with a spike of the other level somewhere inside
+    auto hold = [&](uint8_t level, uint32_t us) {
+        edges.push_back({ level, at & RX_CAPTURE_US_MASK });
+        if (pct(rng) < o.glitchPct && us > 8) {
+            uint32_t split = 2 + rng() % (us - 6);
+            uint32_t spike = 1 + rng() % 3;
+            edges.push_back({ (uint8_t)!level, (at + split) & RX_CAPTURE_US_MASK });
+            edges.push_back({ level, (at + split + spike) & RX_CAPTURE_US_MASK });
+        }
+        at += us;
+    };
+
+    for (uint32_t n = 0; n < o.frames; n++) {
+        Frame f = randomFrame(rng);
+        sent.push_back(f);
+        uint32_t frameStart = at;
+        int bits = Decoder::MSG_BYTES * Decoder::BITS_PER_BYTE;
+        if (pct(rng) < o.truncatePct) bits = rng() % bits;
+
+        hold(LOW, jitter(START_LOW_US));
+        hold(HIGH, jitter(START_HIGH_US));
+        for (int b = 0; b < bits; b++) {
+            bool one = (f[b / 8] >> (b % 8)) & 1;
+            hold(LOW, jitter(one ? BIT1_LOW_US : BIT0_LOW_US));
+            hold(HIGH, jitter(BIT_HIGH_US));
+        }
+        // idle HIGH until the next frame
+        uint32_t used = at - frameStart;
+        at += FRAME_PERIOD_US > used ? FRAME_PERIOD_US - used : 1000;
+    }
+    edges.push_back({ LOW, at & RX_CAPTURE_US_MASK });   // closes the last idle gap
+    return edges;
+}
+
+// -----------------------------------------------------------------------------
+// Decode
+// -----------------------------------------------------------------------------
+
+// Edges to level runs, spikes under filterUs folded into their neighbours
+std::vector<Segment> condition(const std::vector<Edge> &edges, uint32_t filterUs) {
+    std::vector<Segment> out;
+    for (size_t i = 0; i + 1 < edges.size(); i++) {
+        Segment s = { edges[i].level, (edges[i + 1].us - edges[i].us) & RX_CAPTURE_US_MASK };
+        if (!out.empty() && (s.us < filterUs || s.level == out.back().level)) out.back().us += s.us;
+        else out.push_back(s);
+    }
+    return out;
+}
+
+// onFrame(frame, us since the first edge)
+template <typename OnFrame>
+size_t decode(Decoder &decoder, const std::vector<Segment> &segs, uint32_t idleUs, OnFrame onFrame) {
+    size_t pulses = 0;
+    uint64_t at = 0;
+    for (const Segment &s : segs) {
+        at += s.us;
+        if (s.level == LOW) {
+            pulses++;
+            if (decoder.feed(s.us)) onFrame(decoder.frame(), at);
+            decoder.calibrate();
+        } else if (idleUs && s.us >= idleUs) {
+            decoder.reset();
+        }
+    }
+    return pulses;
+}
+
+// fills a fresh Result, the decoder in it can't be copied out
+void replay(const std::vector<Edge> &edges, const Options &o, const std::vector<Frame> *sent, Result &r) {
+    static SkyRoasterParser parser;   // for validate()
+    std::vector<Segment> segs = condition(edges, o.filterUs);
+
+    r.decoder.setAdaptive(o.adaptive);
+    r.pulses = decode(r.decoder, segs, o.idleUs, [&](const uint8_t *frame, uint64_t at) {
+        r.frames++;
+        if (parser.validate(frame)) r.checksumOk++;
+        else r.checksumBad++;
+        // generated frames each own a FRAME_PERIOD_US slot
+        size_t k = at / FRAME_PERIOD_US;
+        if (sent && k < sent->size() && memcmp(frame, (*sent)[k].data(), Decoder::MSG_BYTES) == 0) r.intact++;
+    });
+
+    size_t sink = 0;
+    auto t0 = std::chrono::steady_clock::now();
+    for (uint32_t i = 0; i < o.repeat; i++) {
+        Decoder timed;
+        timed.setAdaptive(o.adaptive);
+        sink += decode(timed, segs, o.idleUs, [&](const uint8_t *f, uint64_t) { sink += f[0]; });
+    }
+    auto t1 = std::chrono::steady_clock::now();
+    double ns = std::chrono::duration<double, std::nano>(t1 - t0).count();
+    if (r.pulses && o.repeat && sink) r.nsPerPulse = ns / ((double)r.pulses * o.repeat);
+}
+
+void report(const char *source, const Options &o, size_t edges, const Result &r, size_t sent) {
+    const RxWindows &w = r.decoder.windows();
+    printf("{\"replay\":\"%s\",\"jitter_us\":%u,\"glitch_pct\":%.2f,\"truncate_pct\":%.2f,\"stretch_pct\":%.1f,"
+           "\"filter_us\":%u,\"idle_us\":%u,\"windows\":\"%s\",\"edges\":%zu,\"pulses\":%zu,\"frames\":%zu,"
+           "\"aborted\":%lu,\"checksum_ok\":%zu,\"checksum_bad\":%zu",
+           source, o.jitterUs, o.glitchPct, o.truncatePct, o.stretchPct, o.filterUs, o.idleUs,
+           o.adaptive ? "adaptive" : "fixed", edges, r.pulses, r.frames,
+           (unsigned long)r.decoder.framesAborted(), r.checksumOk, r.checksumBad);
+    if (sent) printf(",\"sent\":%zu,\"intact\":%zu,\"success\":%.4f", sent, r.intact, (double)r.intact / sent);
+    printf(",\"start_us\":[%u,%u],\"bit0_max_us\":%u,\"bit1_us\":[%u,%u],\"recalibrations\":%lu",
+           w.startMin, w.startMax, w.bit0Max, w.bit1Min, w.bit1Max, (unsigned long)r.decoder.recalibrations());
+    printf(",\"ns_per_pulse\":%.2f,\"mpulses_per_s\":%.1f}\n", r.nsPerPulse,
+           r.nsPerPulse > 0 ? 1000.0 / r.nsPerPulse : 0.0);
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+    Options o;
+    const char *tracePath = nullptr;
+    const char *writePath = nullptr;
+    uint32_t sweepMax = 0, sweepStep = 50;
+    bool sweep = false;
+
+    for (int i = 1; i < argc; i++) {
+        std::string a = argv[i];
+        auto next = [&]() { return i + 1 < argc ? argv[++i] : (char *)"0"; };
+        if (a == "--trace") tracePath = next();
+        else if (a == "--write") writePath = next();
+        else if (a == "--frames") o.frames = atoi(next());
+        else if (a == "--seed") o.seed = atoi(next());
+        else if (a == "--jitter-us") o.jitterUs = atoi(next());
+        else if (a == "--glitch-pct") o.glitchPct = atof(next());
+        else if (a == "--truncate-pct") o.truncatePct = atof(next());
+        else if (a == "--stretch-pct") o.stretchPct = atof(next());
+        else if (a == "--fixed") o.adaptive = false;
+        else if (a == "--filter-us") o.filterUs = atoi(next());
+        else if (a == "--idle-us") o.idleUs = atoi(next());
+        else if (a == "--repeat") o.repeat = atoi(next());
+        else if (a == "--sweep-jitter") {
+            sweep = true;
+            const char *v = next();
+            sweepMax = atoi(v);
+            if (const char *colon = strchr(v, ':')) sweepStep = atoi(colon + 1);
+            if (sweepStep == 0) sweepStep = 1;
+        } else {
+            fprintf(stderr, "usage: %s [--trace FILE | --frames N [--seed N] [--jitter-us N] [--glitch-pct P] "
+                            "[--truncate-pct P] [--stretch-pct P] [--sweep-jitter MAX[:STEP]] [--write FILE]] "
+                            "[--filter-us N] [--idle-us N] [--fixed] [--repeat N]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    if (tracePath) {
+        std::vector<Edge> edges;
+        if (!loadTrace(tracePath, edges)) { fprintf(stderr, "can't read trace\n"); return 1; }
+        Result r;
+        replay(edges, o, nullptr, r);
+        report(tracePath, o, edges.size(), r, 0);
+        return 0;
+    }
+
+    uint32_t lastJitter = sweep ? sweepMax : o.jitterUs;
+    for (uint32_t j = sweep ? 0 : o.jitterUs; j <= lastJitter; j += sweep ? sweepStep : 1) {
+        o.jitterUs = j;
+        std::vector<Frame> sent;
+        std::vector<Edge> edges = generateTrace(o, sent);
+        if (writePath && !sweep && !writeTrace(writePath, edges)) { fprintf(stderr, "can't write trace\n"); return 1; }
+        Result r;
+        replay(edges, o, &sent, r);
+        report("generated", o, edges.size(), r, sent.size());
+    }
+    return 0;
+}
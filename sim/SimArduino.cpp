@@ -0,0 +1,260 @@
+/*
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+// -----------------------------------------------------------------------------
+// Arduino / RMT shim implementation on top of the virtual clock
+// -----------------------------------------------------------------------------
+
+#include <Arduino.h>
+#include <NimBLEDevice.h>
+#include <queue>
+#include <vector>
+#include "SimClock.h"
+
+HardwareSerial Serial;
+void (*simBleOnNotify)(NimBLECharacteristic *, const uint8_t *, size_t, uint16_t) = nullptr;
+
+void String::trim() {
+    size_t b = s_.find_first_not_of(" \t\r\n");
+    size_t e = s_.find_last_not_of(" \t\r\n");
+    s_ = (b == std::string::npos) ? std::string() : s_.substr(b, e - b + 1);
+}
+
+namespace {
+
+struct Event {
+    uint64_t t;
+    uint64_t seq;
+    std::function<void()> fn;
+    bool operator>(const Event &o) const { return t != o.t ? t > o.t : seq > o.seq; }
+};
+
+const int NUM_PINS = 64;
+
+uint64_t clockUs = 0;
+uint64_t eventSeq = 0;
+std::priority_queue<Event, std::vector<Event>, std::greater<Event>> events;
+
+uint8_t pinLevel[NUM_PINS];
+void (*pinIsr[NUM_PINS])(void);
+sim::PinListener pinListener = nullptr;
+
+struct RmtChannel {
+    bool init = false;
+    rmt_ch_dir_t dir = RMT_TX_MODE;
+    uint8_t eotLevel = LOW;
+
+    // TX
+    uint64_t busyUntil = 0;
+
+    // RX
+    bool armed = false;
+    bool complete = false;
+    bool capturing = false;
+    rmt_data_t *data = nullptr;
+    size_t *count = nullptr;
+    size_t max = 0;
+    size_t halves = 0;
+    uint8_t level = HIGH;
+    uint64_t lastEdge = 0;
+    uint64_t idleToken = 0;
+    uint16_t idleTicks = 0xFFFF;
+    uint8_t filterTicks = 0;
+};
+RmtChannel rmt[NUM_PINS];
+
+void outputChanged(uint8_t pin, uint8_t level) {
+    pinLevel[pin] = level;
+    if (pinListener) pinListener(pin, level, clockUs);
+}
+
+void rmtRxFinish(RmtChannel &ch) {
+    if (ch.halves & 1) {
+        rmt_data_t &sym = ch.data[ch.halves / 2];
+        sym.level1 = ch.level;
+        sym.duration1 = 0; // end marker
+        ch.halves++;
+    }
+    *ch.count = ch.halves / 2;
+    ch.armed = false;
+    ch.capturing = false;
+    ch.complete = true;
+}
+
+void rmtRxEdge(uint8_t pin, uint8_t level) {
+    RmtChannel &ch = rmt[pin];
+    if (!ch.armed) return;
+
+    if (!ch.capturing) {
+        if (level != LOW) return;
+        ch.capturing = true;
+    } else {
+        uint64_t dur = clockUs - ch.lastEdge;
+        if (dur <= ch.filterTicks) return; // glitch filter
+        rmt_data_t &sym = ch.data[ch.halves / 2];
+        if (ch.halves & 1) {
+            sym.level1 = ch.level;
+            sym.duration1 = dur > 0x7FFF ? 0x7FFF : dur;
+        } else {
+            sym.val = 0;
+            sym.level0 = ch.level;
+            sym.duration0 = dur > 0x7FFF ? 0x7FFF : dur;
+        }
+        ch.halves++;
+        if (ch.halves / 2 >= ch.max) { rmtRxFinish(ch); return; }
+    }
+    ch.level = level;
+    ch.lastEdge = clockUs;
+
+    // a level held longer than the idle threshold ends the capture
+    uint64_t token = ++ch.idleToken;
+    sim::schedule(clockUs + ch.idleTicks + 1, [pin, token]() {
+        RmtChannel &c = rmt[pin];
+        if (c.capturing && c.idleToken == token) rmtRxFinish(c);
+    });
+}
+
+} // namespace
+
+// -----------------------------------------------------------------------------
+// Clock
+// -----------------------------------------------------------------------------
+namespace sim {
+
+uint64_t nowUs() { return clockUs; }
+
+void schedule(uint64_t t, std::function<void()> fn) {
+    events.push(Event{t < clockUs ? clockUs : t, eventSeq++, std::move(fn)});
+}
+
+void advanceTo(uint64_t t) {
+    while (!events.empty() && events.top().t <= t) {
+        Event ev = events.top();
+        events.pop();
+        clockUs = ev.t;
+        ev.fn();
+    }
+    if (t > clockUs) clockUs = t;
+}
+
+void advanceBy(uint64_t us) { advanceTo(clockUs + us); }
+
+void drivePin(uint8_t pin, uint8_t level) {
+    if (pin >= NUM_PINS || pinLevel[pin] == level) return;
+    pinLevel[pin] = level;
+    if (pinIsr[pin]) pinIsr[pin]();
+    rmtRxEdge(pin, level);
+}
+
+void setPinListener(PinListener listener) { pinListener = listener; }
+
+} // namespace sim
+
+unsigned long micros() { return (unsigned long)(uint32_t)clockUs; }
+unsigned long millis() { return (unsigned long)(uint32_t)(clockUs / 1000); }
+void delay(unsigned long ms) { sim::advanceBy((uint64_t)ms * 1000); }
+void delayMicroseconds(unsigned int us) { sim::advanceBy(us); }
+
+// -----------------------------------------------------------------------------
+// GPIO
+// -----------------------------------------------------------------------------
+void pinMode(uint8_t pin, uint8_t mode) {
+    if (pin < NUM_PINS && mode == INPUT_PULLUP) pinLevel[pin] = HIGH;
+}
+
+void digitalWrite(uint8_t pin, uint8_t val) {
+    if (pin < NUM_PINS && pinLevel[pin] != val) outputChanged(pin, val);
+}
+
+int digitalRead(uint8_t pin) { return pin < NUM_PINS ? pinLevel[pin] : LOW; }
+
+void attachInterrupt(uint8_t pin, void (*isr)(void), int) {
+    if (pin < NUM_PINS) pinIsr[pin] = isr;
+}
+
+void detachInterrupt(uint8_t pin) {
+    if (pin < NUM_PINS) pinIsr[pin] = nullptr;
+}
+
+// -----------------------------------------------------------------------------
+// RMT, 1 tick == 1us
+// -----------------------------------------------------------------------------
+bool rmtInit(int pin, rmt_ch_dir_t dir, rmt_reserve_memsize_t, uint32_t frequency_Hz) {
+    if (pin < 0 || pin >= NUM_PINS || frequency_Hz != 1000000) return false;
+    rmt[pin] = RmtChannel();
+    rmt[pin].init = true;
+    rmt[pin].dir = dir;
+    return true;
+}
+
+bool rmtSetEOT(int pin, uint8_t level) {
+    if (pin < 0 || pin >= NUM_PINS || !rmt[pin].init) return false;
+    rmt[pin].eotLevel = level;
+    return true;
+}
+
+bool rmtWriteAsync(int pin, rmt_data_t *data, size_t num) {
+    if (pin < 0 || pin >= NUM_PINS || !rmt[pin].init || rmt[pin].dir != RMT_TX_MODE) return false;
+    RmtChannel &ch = rmt[pin];
+    if (clockUs < ch.busyUntil) return false;
+
+    uint64_t t = clockUs;
+    for (size_t i = 0; i < num; i++) {
+        uint8_t l0 = data[i].level0, l1 = data[i].level1;
+        sim::schedule(t, [pin, l0]() { if (pinLevel[pin] != l0) outputChanged(pin, l0); });
+        t += data[i].duration0;
+        sim::schedule(t, [pin, l1]() { if (pinLevel[pin] != l1) outputChanged(pin, l1); });
+        t += data[i].duration1;
+    }
+    uint8_t eot = ch.eotLevel;
+    sim::schedule(t, [pin, eot]() { if (pinLevel[pin] != eot) outputChanged(pin, eot); });
+    ch.busyUntil = t;
+    return true;
+}
+
+bool rmtTransmitCompleted(int pin) {
+    if (pin < 0 || pin >= NUM_PINS) return true;
+    return clockUs >= rmt[pin].busyUntil;
+}
+
+bool rmtReadAsync(int pin, rmt_data_t *data, size_t *num) {
+    if (pin < 0 || pin >= NUM_PINS || !rmt[pin].init || rmt[pin].dir != RMT_RX_MODE) return false;
+    RmtChannel &ch = rmt[pin];
+    ch.data = data;
+    ch.count = num;
+    ch.max = *num;
+    ch.halves = 0;
+    ch.armed = true;
+    ch.complete = false;
+    ch.capturing = false;
+    return true;
+}
+
+bool rmtReceiveCompleted(int pin) {
+    if (pin < 0 || pin >= NUM_PINS) return false;
+    return rmt[pin].complete;
+}
+
+bool rmtSetRxMaxThreshold(int pin, uint16_t idle_thres_ticks) {
+    if (pin < 0 || pin >= NUM_PINS || !rmt[pin].init) return false;
+    rmt[pin].idleTicks = idle_thres_ticks;
+    return true;
+}
+
+bool rmtSetRxMinThreshold(int pin, uint8_t filter_pulse_ticks) {
+    if (pin < 0 || pin >= NUM_PINS || !rmt[pin].init) return false;
+    rmt[pin].filterTicks = filter_pulse_ticks;
+    return true;
+}
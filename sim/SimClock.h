@@ -0,0 +1,43 @@
+/*
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+// -----------------------------------------------------------------------------
+// Virtual clock and simulated wire
+// Everything that happens "in hardware" (roaster edges, RMT playback, RMT
+// capture timeouts) is an event on one timeline. Firmware time only moves when
+// the sim advances it or the firmware calls delay()/delayMicroseconds().
+// -----------------------------------------------------------------------------
+
+#include <stdint.h>
+#include <functional>
+
+namespace sim {
+
+uint64_t nowUs();
+void advanceTo(uint64_t t);
+void advanceBy(uint64_t us);
+void schedule(uint64_t t, std::function<void()> fn);
+
+// Drive an input pin from outside (roaster -> ESP32): fires attached ISRs and
+// feeds any RMT capture armed on that pin
+void drivePin(uint8_t pin, uint8_t level);
+
+// Observe output pins (ESP32 -> roaster), from digitalWrite() or RMT playback
+typedef void (*PinListener)(uint8_t pin, uint8_t level, uint64_t t);
+void setPinListener(PinListener listener);
+
+} // namespace sim
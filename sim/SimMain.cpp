@@ -0,0 +1,519 @@
+/*
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+// -----------------------------------------------------------------------------
+// Accelerated-time roast simulator
+// Runs the firmware's setup()/loop() against SimRoaster on the virtual clock,
+// with a scripted HiBean-like central writing commands over the BLE shim.
+//
+//   sim [--duration S] [--loop-us N] [--poll-ms N] [--telemetry-ms N]
+//       [--script FILE] [--rx-period-us N] [--jitter-us N] [--spike-every N]
+//       [--profile FILE] [--observers N] [--verbose]
+//
+// Script lines are "<seconds> <command>", e.g. "120 PID;SV;200". HiBean is
+// connection 1 and writes first, so it holds the controller role; --observers
+// connects N more centrals (2, 3, ...) that subscribe to telemetry and
+// replies, and "<seconds> @2 <command>" writes from one of them.
+// "<seconds> @pipe <command>" goes in over the in-memory command transport
+// instead of BLE, the way a wired Artisan would; its replies come straight back.
+// Profile lines are "<seconds> <setpoint C> <fan %> <drum 0|1>"; the profile is
+// uploaded over the PROFILE characteristic right after connecting, the script
+// still has to send PROFILE;START.
+// -----------------------------------------------------------------------------
+
+#include <Arduino.h>
+#include <NimBLEDevice.h>
+#include <algorithm>
+#include <chrono>
+#include <string>
+#include <vector>
+#include "SimClock.h"
+#include "SimRoaster.h"
+
+void setup();
+void loop();
+void simFirmwareReport();
+void simPipeAttach();
+bool simPipeWrite(const char *line, size_t len);
+size_t simPipeRead(char *dst, size_t max);
+
+namespace {
+
+const char *UUID_RX = "6e400002-b5a3-f393-e0a9-e50e24dcca9e";
+const char *UUID_TX = "6e400003-b5a3-f393-e0a9-e50e24dcca9e";
+const char *UUID_TELEMETRY = "6dbf0301-758d-4b5e-bc11-40cfaea42dfe";
+const char *UUID_PROFILE = "6dbf0401-758d-4b5e-bc11-40cfaea42dfe";
+const char *UUID_RECORDER = "6dbf0501-758d-4b5e-bc11-40cfaea42dfe";
+const uint16_t SIM_MTU = 185;
+
+struct ScriptLine {
+    double atS;
+    std::string cmd;
+};
+
+// Default roast: charge, ramp on manual heat, hand over to PID, cool, off
+const ScriptLine DEFAULT_SCRIPT[] = {
+    {1, "CHAN"},
+    {1.5, "UNITS;C"},
+    {2, "DRUM;100"},
+    {2.5, "OT2;30"},
+    {3, "OT1;80"},
+    {120, "PID;SV;200"},
+    {120.5, "PID;ON"},
+    {300, "PID;SV;215"},
+    {480, "OT2;60"},
+    {600, "PID;OFF"},
+    {600.5, "OT1;0"},
+    {601, "COOL;100"},
+    {601.5, "OT2;100"},
+    {780, "COOL;0"},
+    {781, "DRUM;0"},
+    {782, "OFF"},
+};
+
+class Samples {
+public:
+    void add(double v) { v_.push_back(v); }
+    size_t count() const { return v_.size(); }
+    double pct(double p) {
+        if (v_.empty()) return 0;
+        std::sort(v_.begin(), v_.end());
+        return v_[std::min(v_.size() - 1, (size_t)(p / 100.0 * v_.size()))];
+    }
+    double mean() const {
+        double s = 0;
+        for (double v : v_) s += v;
+        return v_.empty() ? 0 : s / v_.size();
+    }
+    double max() const { return v_.empty() ? 0 : *std::max_element(v_.begin(), v_.end()); }
+private:
+    std::vector<double> v_;
+};
+
+// A control change waiting to show up in a roaster frame
+struct Expect {
+    int byte;
+    uint8_t value;
+    uint64_t sentUs;
+};
+
+SimRoaster *roasterModel = nullptr;
+bool verbose = false;
+bool pidOn = false;
+std::vector<Expect> expects;
+std::vector<uint64_t> pendingReads;
+Samples cmdToFrameMs;
+Samples readToNotifyMs;
+Samples loopUs;
+Samples readErrC;
+uint64_t commandsSent = 0;
+uint64_t notifies = 0;
+uint64_t readsMerged = 0;
+uint64_t telemetryPackets = 0;
+uint64_t telemetryBytes = 0;
+const uint16_t SIM_MAX_CENTRALS = 8;
+uint64_t telemetryByConn[SIM_MAX_CENTRALS + 1] = {};
+uint64_t repliesByConn[SIM_MAX_CENTRALS + 1] = {};
+std::vector<std::vector<uint8_t>> recorderNotes;
+std::vector<uint64_t> pendingPipeReads;
+Samples pipeReadMs;
+uint64_t pipeCommands = 0;
+uint64_t pipeReplies = 0;
+
+void onRoasterFrame(const uint8_t *frame, uint64_t t) {
+    for (size_t i = 0; i < expects.size();) {
+        if (frame[expects[i].byte] == expects[i].value) {
+            cmdToFrameMs.add((t - expects[i].sentUs) / 1000.0);
+            expects.erase(expects.begin() + i);
+        } else {
+            i++;
+        }
+    }
+}
+
+void onNotify(NimBLECharacteristic *chr, const uint8_t *data, size_t len, uint16_t connHandle) {
+    uint16_t conn = connHandle <= SIM_MAX_CENTRALS ? connHandle : 0;
+    if (chr->getUUID() == UUID_TELEMETRY) {
+        telemetryByConn[conn]++;
+        if (conn != 1) return;   // HiBean's view
+        telemetryPackets++; telemetryBytes += len;
+        return;
+    }
+    if (chr->getUUID() == UUID_RECORDER) { recorderNotes.emplace_back(data, data + len); return; }
+    if (chr->getUUID() != UUID_TX) return;
+    repliesByConn[conn]++;
+    if (conn != 1) return;
+    notifies++;
+    std::string msg((const char *)data, len);
+    if (!pendingReads.empty() && msg.size() && msg[0] != '#') {
+        // one reply answers every READ still outstanding, time it from the oldest
+        readToNotifyMs.add((sim::nowUs() - pendingReads.front()) / 1000.0);
+        readsMerged += pendingReads.size() - 1;
+        pendingReads.clear();
+    }
+    double bt;
+    if (roasterModel && sscanf(msg.c_str(), "0,%lf,", &bt) == 1) readErrC.add(fabs(bt - roasterModel->beanTempC()));
+    if (verbose) printf("[%10.3f] notify: %s", sim::nowUs() / 1e6, msg.c_str());
+}
+
+void trackExpectation(const std::string &cmd, uint64_t now) {
+    size_t sep = cmd.find_first_of("|\n");
+    if (sep != std::string::npos) {   // a batch: each command in turn
+        trackExpectation(cmd.substr(0, sep), now);
+        trackExpectation(cmd.substr(sep + 1), now);
+        return;
+    }
+    std::string c = cmd;
+    for (auto &ch : c) ch = toupper((unsigned char)ch);
+    size_t semi = c.find(';');
+    std::string head = c.substr(0, semi);
+    int value = semi == std::string::npos ? 0 : atoi(c.c_str() + semi + 1);
+
+    if (c == "PID;ON") pidOn = true;
+    else if (c == "PID;OFF") pidOn = false;
+    else if (head == "READ") pendingReads.push_back(now);
+    else if (head == "OT1" && !pidOn) expects.push_back({4, (uint8_t)value, now});
+    else if (head == "OT2") expects.push_back({0, (uint8_t)value, now});
+    else if (head == "COOL") expects.push_back({2, (uint8_t)value, now});
+    else if (head == "DRUM") expects.push_back({3, (uint8_t)(value ? 100 : 0), now});
+}
+
+void pipeWrite(const std::string &cmd) {
+    if (!simPipeWrite(cmd.c_str(), cmd.size())) return;
+    pipeCommands++;
+    std::string c = cmd;
+    for (auto &ch : c) ch = toupper((unsigned char)ch);
+    if (c.compare(0, 4, "READ") == 0) pendingPipeReads.push_back(sim::nowUs());
+}
+
+void pipeDrain() {
+    char msg[256];
+    while (simPipeRead(msg, sizeof(msg))) {
+        pipeReplies++;
+        if (!pendingPipeReads.empty() && msg[0] != '#') {
+            pipeReadMs.add((sim::nowUs() - pendingPipeReads.front()) / 1000.0);
+            pendingPipeReads.erase(pendingPipeReads.begin());
+        }
+        if (verbose) printf("[%10.3f] pipe: %s", sim::nowUs() / 1e6, msg);
+    }
+}
+
+// "@N cmd" writes from central N, "@pipe cmd" over the pipe, anything else
+// from HiBean (1)
+void bleWrite(const std::string &line) {
+    if (line.compare(0, 6, "@pipe ") == 0) { pipeWrite(line.substr(6)); return; }
+    NimBLEServer *server = NimBLEDevice::getServer();
+    NimBLECharacteristic *rx = server ? server->findCharacteristic(UUID_RX) : nullptr;
+    if (!rx || !rx->getCallbacks()) return;
+
+    uint16_t handle = 1;
+    std::string cmd = line;
+    if (cmd.size() > 1 && cmd[0] == '@') {
+        size_t sp = cmd.find(' ');
+        handle = atoi(cmd.c_str() + 1);
+        cmd = sp == std::string::npos ? "" : cmd.substr(sp + 1);
+    }
+    if (handle == 1) {
+        trackExpectation(cmd, sim::nowUs());
+        commandsSent++;
+    }
+    std::string payload = cmd + "\n";
+    rx->setValue(payload);
+    NimBLEConnInfo conn(handle);
+    rx->getCallbacks()->onWrite(rx, conn);
+}
+
+// connect, swap MTUs and turn on notifications like a phone would
+void connectCentral(uint16_t handle, bool telemetry) {
+    NimBLEServer *server = NimBLEDevice::getServer();
+    if (!server || !server->getCallbacks()) return;
+    NimBLEConnInfo conn(handle);
+    server->getCallbacks()->onConnect(server, conn);
+    server->getCallbacks()->onMTUChange(SIM_MTU, conn);
+    const char *subs[] = { UUID_TX, UUID_RECORDER, telemetry ? UUID_TELEMETRY : nullptr };
+    for (const char *uuid : subs) {
+        if (NimBLECharacteristic *chr = uuid ? server->findCharacteristic(uuid) : nullptr) chr->simSubscribe(conn, true);
+    }
+}
+
+struct ProfileLine {
+    uint16_t timeS;
+    int16_t deciC;
+    uint8_t fan;
+    uint8_t drum;
+};
+
+void writeCharacteristic(const char *uuid, const uint8_t *data, size_t len) {
+    NimBLEServer *server = NimBLEDevice::getServer();
+    NimBLECharacteristic *chr = server ? server->findCharacteristic(uuid) : nullptr;
+    if (!chr || !chr->getCallbacks()) return;
+    chr->setValue(data, len);
+    NimBLEConnInfo conn(1);
+    conn.setMTU(SIM_MTU);
+    chr->getCallbacks()->onWrite(chr, conn);
+}
+
+// begin, points three at a time, commit - each write fits 20 bytes
+void uploadProfile(const std::vector<ProfileLine> &pts) {
+    uint8_t begin[2] = {0x01, (uint8_t)pts.size()};
+    writeCharacteristic(UUID_PROFILE, begin, 2);
+
+    uint16_t sum = 0;
+    for (size_t i = 0; i < pts.size(); i += 3) {
+        uint8_t buf[20] = {0x02, (uint8_t)i};
+        size_t len = 2;
+        for (size_t j = i; j < pts.size() && j < i + 3; j++) {
+            const ProfileLine &p = pts[j];
+            uint8_t b[6] = {(uint8_t)p.timeS, (uint8_t)(p.timeS >> 8), (uint8_t)p.deciC,
+                            (uint8_t)((uint16_t)p.deciC >> 8), p.fan, p.drum};
+            for (uint8_t v : b) { buf[len++] = v; sum += v; }
+        }
+        writeCharacteristic(UUID_PROFILE, buf, len);
+    }
+
+    uint8_t commit[3] = {0x03, (uint8_t)sum, (uint8_t)(sum >> 8)};
+    writeCharacteristic(UUID_PROFILE, commit, 3);
+}
+
+void subscribeTelemetry(uint16_t periodMs) {
+    uint8_t v[2] = {(uint8_t)periodMs, (uint8_t)(periodMs >> 8)};
+    writeCharacteristic(UUID_TELEMETRY, v, 2);
+}
+
+uint32_t getLE32(const uint8_t *p) { return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24); }
+
+int32_t getVarint(const std::vector<uint8_t> &b, size_t &i) {
+    uint32_t z = 0;
+    for (int shift = 0; i < b.size(); shift += 7) {
+        uint8_t c = b[i++];
+        z |= (uint32_t)(c & 0x7F) << shift;
+        if (!(c & 0x80)) break;
+    }
+    return (int32_t)(z >> 1) ^ -(int32_t)(z & 1);
+}
+
+// Pull the newest roast log the way a client would: list, then stream it with
+// credits, dropping the transfer half way and resuming from the last offset
+void checkRecorder(uint32_t loopCostUs) {
+    auto run = [&](uint32_t ms) {
+        uint64_t until = sim::nowUs() + ms * 1000ULL;
+        while (sim::nowUs() < until) { loop(); sim::advanceBy(loopCostUs); }
+    };
+
+    recorderNotes.clear();
+    uint8_t list = 0x01;
+    writeCharacteristic(UUID_RECORDER, &list, 1);
+    run(100);
+    uint16_t id = 0;
+    for (auto &n : recorderNotes) if (n[0] == 0x81) id = n[1] | (n[2] << 8);
+    if (!id) { printf("recorder           no logs\n"); return; }
+
+    std::vector<uint8_t> log;
+    uint32_t size = 0, resumedAt = 0;
+    size_t chunks = 0;
+    bool done = false, resumed = false;
+    recorderNotes.clear();
+    uint8_t get[8] = {0x02, (uint8_t)id, (uint8_t)(id >> 8), 0, 0, 0, 0, 4};
+    writeCharacteristic(UUID_RECORDER, get, sizeof(get));
+    for (int round = 0; round < 1000 && !done; round++) {
+        run(60);
+        size_t got = 0;
+        for (auto &n : recorderNotes) {
+            if (n[0] == 0x82 && getLE32(&n[1]) == log.size()) { log.insert(log.end(), n.begin() + 5, n.end()); got++; chunks++; }
+            if (n[0] == 0x83) { size = getLE32(&n[3]); done = true; }
+            if (n[0] == 0x85) { printf("recorder           error %u\n", n[1]); return; }
+        }
+        recorderNotes.clear();
+        if (done) break;
+        if (!resumed && chunks >= 3) {
+            // link dropped: stop, then ask again from where we got to
+            uint8_t stop = 0x04;
+            writeCharacteristic(UUID_RECORDER, &stop, 1);
+            run(60);
+            recorderNotes.clear();
+            resumedAt = log.size();
+            uint8_t again[8] = {0x02, (uint8_t)id, (uint8_t)(id >> 8), (uint8_t)resumedAt, (uint8_t)(resumedAt >> 8),
+                                (uint8_t)(resumedAt >> 16), (uint8_t)(resumedAt >> 24), 4};
+            writeCharacteristic(UUID_RECORDER, again, sizeof(again));
+            resumed = true;
+        } else if (got) {
+            uint8_t credit[2] = {0x03, (uint8_t)got};
+            writeCharacteristic(UUID_RECORDER, credit, 2);
+        }
+    }
+
+    size_t records = 0, keys = 0;
+    int32_t bt = 0;
+    bool ok = done && log.size() == size && size >= 12 && log[0] == 'S' && log[1] == 'K' && log[2] == 'R';
+    for (size_t i = 12; ok && i < log.size();) {
+        uint8_t mask = log[i++];
+        int32_t v = getVarint(log, i);
+        bt = (mask & 0x40) ? v : bt + v;
+        for (int b = 0; b < 5; b++) if (mask & (1 << b)) i++;
+        if (mask & 0x20) getVarint(log, i);
+        records++;
+        if (mask & 0x40) keys++;
+    }
+    printf("recorder           log #%u %s: %u bytes in %zu chunks (resumed at %u), %zu records (%zu key), "
+           "%.1f B/record, last BT %.1f C\n", id, ok ? "ok" : "BAD", size, chunks, resumedAt, records, keys,
+           records ? (size - 12.0) / records : 0.0, bt / 100.0);
+}
+
+bool loadProfile(const char *path, std::vector<ProfileLine> &out) {
+    FILE *f = fopen(path, "r");
+    if (!f) return false;
+    char line[128];
+    while (fgets(line, sizeof(line), f)) {
+        double t, sv;
+        int fan, drum;
+        if (line[0] == '#' || sscanf(line, "%lf %lf %d %d", &t, &sv, &fan, &drum) != 4) continue;
+        out.push_back({(uint16_t)t, (int16_t)lround(sv * 10), (uint8_t)fan, (uint8_t)drum});
+    }
+    fclose(f);
+    return true;
+}
+
+bool loadScript(const char *path, std::vector<ScriptLine> &out) {
+    FILE *f = fopen(path, "r");
+    if (!f) return false;
+    char line[256];
+    while (fgets(line, sizeof(line), f)) {
+        double at;
+        char cmd[200];
+        if (line[0] == '#' || sscanf(line, "%lf %199[^\r\n]", &at, cmd) != 2) continue;
+        out.push_back({at, cmd});
+    }
+    fclose(f);
+    return true;
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+    double durationS = 900;
+    uint32_t loopCostUs = 100;
+    uint32_t pollMs = 1000;
+    uint32_t telemetryMs = 0;
+    int observers = 0;
+    SimRoasterConfig cfg;
+    std::vector<ScriptLine> script;
+    std::vector<ProfileLine> profile;
+
+    for (int i = 1; i < argc; i++) {
+        std::string a = argv[i];
+        auto next = [&]() { return i + 1 < argc ? argv[++i] : (char *)"0"; };
+        if (a == "--duration") durationS = atof(next());
+        else if (a == "--loop-us") loopCostUs = atoi(next());
+        else if (a == "--poll-ms") pollMs = atoi(next());
+        else if (a == "--telemetry-ms") telemetryMs = atoi(next());
+        else if (a == "--rx-period-us") cfg.rxPeriodUs = atoi(next());
+        else if (a == "--jitter-us") cfg.rxJitterUs = atoi(next());
+        else if (a == "--spike-every") cfg.rxSpikeEvery = atoi(next());
+        else if (a == "--observers") observers = std::min(atoi(next()), SIM_MAX_CENTRALS - 1);
+        else if (a == "--verbose") verbose = true;
+        else if (a == "--profile") {
+            if (!loadProfile(next(), profile)) { fprintf(stderr, "can't read profile\n"); return 1; }
+        } else if (a == "--script") {
+            if (!loadScript(next(), script)) { fprintf(stderr, "can't read script\n"); return 1; }
+        } else {
+            fprintf(stderr, "usage: %s [--duration S] [--loop-us N] [--poll-ms N] [--telemetry-ms N] "
+                            "[--script FILE] [--rx-period-us N] [--jitter-us N] [--spike-every N] [--profile FILE] [--observers N] [--verbose]\n", argv[0]);
+            return 1;
+        }
+    }
+    if (script.empty()) script.assign(std::begin(DEFAULT_SCRIPT), std::end(DEFAULT_SCRIPT));
+    std::stable_sort(script.begin(), script.end(),
+                     [](const ScriptLine &a, const ScriptLine &b) { return a.atS < b.atS; });
+    if (loopCostUs == 0) loopCostUs = 1;
+
+    auto wallStart = std::chrono::steady_clock::now();
+
+    SimRoaster roaster(cfg);
+    roaster.onFrame = onRoasterFrame;
+    roasterModel = &roaster;
+    roaster.start();
+    simBleOnNotify = onNotify;
+
+    setup();
+    simPipeAttach();
+
+    // HiBean connects once we're advertising
+    connectCentral(1, telemetryMs != 0);
+    for (int i = 0; i < observers; i++) connectCentral(2 + i, true);
+    if (telemetryMs) subscribeTelemetry(telemetryMs);
+    if (!profile.empty()) uploadProfile(profile);
+
+    uint64_t startUs = sim::nowUs();
+    uint64_t endUs = startUs + (uint64_t)(durationS * 1e6);
+    uint64_t nextPollUs = startUs + pollMs * 1000ULL;
+    size_t nextLine = 0;
+    uint64_t loops = 0;
+
+    while (sim::nowUs() < endUs) {
+        uint64_t now = sim::nowUs();
+        while (nextLine < script.size() && startUs + (uint64_t)(script[nextLine].atS * 1e6) <= now) {
+            if (verbose) printf("[%10.3f] write: %s\n", now / 1e6, script[nextLine].cmd.c_str());
+            bleWrite(script[nextLine++].cmd);
+        }
+        if (pollMs && now >= nextPollUs) {
+            bleWrite("READ");
+            nextPollUs += pollMs * 1000ULL;
+        }
+
+        uint64_t before = sim::nowUs();
+        loop();
+        pipeDrain();
+        sim::advanceBy(loopCostUs); // CPU time of one pass
+        loopUs.add((double)(sim::nowUs() - before));
+        loops++;
+    }
+
+    double simS = (sim::nowUs() - startUs) / 1e6;
+    double wallS = std::chrono::duration<double>(std::chrono::steady_clock::now() - wallStart).count();
+
+    printf("simulated          %.1f s in %.2f s wall (%.0fx)\n", simS, wallS, simS / wallS);
+    printf("loop() passes      %llu, period avg %.0f us, p99 %.0f us, max %.0f us\n",
+           (unsigned long long)loops, loopUs.mean(), loopUs.pct(99), loopUs.max());
+    printf("roaster frames rx  %u (%.2f/s), bad checksum %u, aborted %u, max gap %.1f ms\n",
+           roaster.framesDecoded, roaster.framesDecoded / simS, roaster.framesBadChecksum,
+           roaster.framesAborted, roaster.maxFrameGapUs / 1000.0);
+    printf("roaster frames tx  %u (%.2f/s)\n", roaster.framesSent, roaster.framesSent / simS);
+    printf("commands           %llu, notifies %llu\n", (unsigned long long)commandsSent, (unsigned long long)notifies);
+    printf("cmd -> frame       n=%zu avg %.1f ms, p50 %.1f ms, p99 %.1f ms, max %.1f ms, unmatched %zu\n",
+           cmdToFrameMs.count(), cmdToFrameMs.mean(), cmdToFrameMs.pct(50), cmdToFrameMs.pct(99),
+           cmdToFrameMs.max(), expects.size());
+    printf("READ -> notify     n=%zu avg %.1f ms, p99 %.1f ms, max %.1f ms, merged %llu\n",
+           readToNotifyMs.count(), readToNotifyMs.mean(), readToNotifyMs.pct(99), readToNotifyMs.max(),
+           (unsigned long long)readsMerged);
+    if (pipeCommands) {
+        printf("pipe               %llu commands, %llu replies, READ -> reply n=%zu avg %.1f ms, max %.1f ms\n",
+               (unsigned long long)pipeCommands, (unsigned long long)pipeReplies, pipeReadMs.count(),
+               pipeReadMs.mean(), pipeReadMs.max());
+    }
+    printf("telemetry          %llu packets (%.2f/s), %llu bytes\n", (unsigned long long)telemetryPackets,
+           telemetryPackets / simS, (unsigned long long)telemetryBytes);
+    if (observers) {
+        printf("centrals           telemetry/replies");
+        for (int c = 1; c <= 1 + observers; c++) {
+            printf(" %d: %llu/%llu", c, (unsigned long long)telemetryByConn[c], (unsigned long long)repliesByConn[c]);
+        }
+        printf("\n");
+    }
+    printf("bean temp          %.1f C, READ error vs probe p50 %.2f C, p99 %.2f C, max %.2f C\n",
+           roaster.beanTempC(), readErrC.pct(50), readErrC.pct(99), readErrC.max());
+    simFirmwareReport();
+    checkRecorder(loopCostUs);
+    return 0;
+}
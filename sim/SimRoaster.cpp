@@ -0,0 +1,152 @@
+/*
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <Arduino.h>
+#include "SimClock.h"
+#include "SimRoaster.h"
+
+namespace {
+
+const uint32_t STEP_US = 10000; // thermal model step
+
+// Same polynomials as SkyRoasterParser::getTemperature()
+double polyX(uint16_t raw) {
+    double x = 0.001 * raw;
+    return -278.33 * x * x * x + 491.944 * x * x - 451.444 * x + 310.668;
+}
+
+double polyY(uint16_t raw) {
+    double y = 0.001 * raw;
+    return -224.2 * y * y * y + 385.9 * y * y - 327.1 * y + 171;
+}
+
+// both polynomials fall monotonically, binary search for the closest raw
+uint16_t invert(double (*poly)(uint16_t), uint16_t lo, uint16_t hi, double target) {
+    while (lo < hi) {
+        uint16_t mid = lo + (hi - lo) / 2;
+        if (poly(mid) > target) lo = mid + 1;
+        else hi = mid;
+    }
+    return lo;
+}
+
+SimRoaster *active = nullptr;
+
+void pinListener(uint8_t pin, uint8_t level, uint64_t t) {
+    (void)pin;
+    if (active) active->onTxEdge(level, t);
+}
+
+} // namespace
+
+SimRoaster::SimRoaster(const SimRoasterConfig &c) : cfg(c), chamberC(c.ambientC), probeC(c.ambientC) {}
+
+void SimRoaster::encodeTemperature(double tempC, uint16_t &rawX, uint16_t &rawY) {
+    if (tempC >= polyX(836)) {
+        rawY = 0;
+        rawX = invert(polyX, 0, 836, tempC);
+    } else {
+        rawX = 1000;
+        rawY = invert(polyY, 222, 4000, tempC);
+    }
+}
+
+void SimRoaster::start() {
+    active = this;
+    sim::setPinListener(pinListener);
+    lastStepUs = sim::nowUs();
+    sim::schedule(lastStepUs + STEP_US, [this]() { step(sim::nowUs()); });
+    sim::schedule(lastStepUs + cfg.rxPeriodUs, [this]() { sendFrame(sim::nowUs()); });
+}
+
+void SimRoaster::step(uint64_t t) {
+    double dt = (t - lastStepUs) / 1e6;
+    lastStepUs = t;
+
+    double heatIn = (drum() ? 1.0 : 0.5) * cfg.heatGainCps * heat() / 100.0;
+    double loss = cfg.lossPerS * (1.0 + 0.5 * vent() / 100.0 + 2.0 * cool() / 100.0);
+    chamberC += dt * (heatIn - loss * (chamberC - cfg.ambientC));
+    probeC += dt * (chamberC - probeC) / cfg.sensorLagS;
+
+    sim::schedule(t + STEP_US, [this]() { step(sim::nowUs()); });
+}
+
+void SimRoaster::sendFrame(uint64_t t) {
+    uint16_t rawX, rawY;
+    bool spike = cfg.rxSpikeEvery && (framesSent + 1) % cfg.rxSpikeEvery == 0;
+    encodeTemperature(spike ? probeC + 80.0 : probeC, rawX, rawY);
+    uint8_t msg[7] = {(uint8_t)(rawX >> 8), (uint8_t)rawX, (uint8_t)(rawY >> 8), (uint8_t)rawY, 0, 0, 0};
+    for (int i = 0; i < 6; i++) msg[6] += msg[i];
+
+    auto jitter = [this](uint32_t us) -> uint32_t {
+        if (!cfg.rxJitterUs) return us;
+        return us + (rand() % (2 * cfg.rxJitterUs + 1)) - cfg.rxJitterUs;
+    };
+
+    uint8_t pin = cfg.rxPin;
+    uint64_t at = t;
+    auto pulse = [&](uint32_t lowUs, uint32_t highUs) {
+        sim::schedule(at, [pin]() { sim::drivePin(pin, LOW); });
+        at += jitter(lowUs);
+        sim::schedule(at, [pin]() { sim::drivePin(pin, HIGH); });
+        at += highUs;
+    };
+
+    pulse(7500, 3800);
+    for (int i = 0; i < 7; i++)
+        for (int b = 0; b < 8; b++)
+            pulse(((msg[i] >> b) & 1) ? 1500 : 650, 750);
+
+    framesSent++;
+    uint64_t next = t + cfg.rxPeriodUs;
+    if (next < at + 1000) next = at + 1000;
+    sim::schedule(next, [this]() { sendFrame(sim::nowUs()); });
+}
+
+void SimRoaster::onTxEdge(uint8_t level, uint64_t t) {
+    if (level == LOW) {
+        lowStart = t;
+        return;
+    }
+
+    uint64_t lowUs = t - lowStart;
+    if (!receiving) {
+        if (lowUs >= 7000 && lowUs <= 10000) {
+            receiving = true;
+            bit = 0;
+            for (int i = 0; i < 6; i++) rx[i] = 0;
+        }
+        return;
+    }
+
+    int value;
+    if (lowUs < 900) value = 0;
+    else if (lowUs >= 1200 && lowUs <= 2000) value = 1;
+    else { receiving = false; framesAborted++; return; }
+
+    rx[bit / 8] |= value << (bit % 8);
+    if (++bit < 48) return;
+
+    receiving = false;
+    uint8_t sum = 0;
+    for (int i = 0; i < 5; i++) sum += rx[i];
+    if (sum != rx[5]) { framesBadChecksum++; return; }
+
+    for (int i = 0; i < 6; i++) ctrl[i] = rx[i];
+    framesDecoded++;
+    if (lastFrameEndUs && t - lastFrameEndUs > maxFrameGapUs) maxFrameGapUs = t - lastFrameEndUs;
+    lastFrameEndUs = t;
+    if (onFrame) onFrame(ctrl, t);
+}
@@ -0,0 +1,86 @@
+/*
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+// -----------------------------------------------------------------------------
+// Simulated Skywalker v1
+// Decodes control frames off the TX pin, runs a first-order thermal model from
+// the heat/vent settings and sends bean temperature frames back on the RX pin
+// with the same pulse timing as the real roaster.
+// -----------------------------------------------------------------------------
+
+#include <stdint.h>
+#include <stddef.h>
+
+struct SimRoasterConfig {
+    uint8_t txPin = 1;                // ESP32 -> roaster
+    uint8_t rxPin = 2;                // roaster -> ESP32
+    uint32_t rxPeriodUs = 150000;     // bean temp frame cadence
+    uint32_t rxJitterUs = 0;          // +/- random stretch on every pulse
+    uint32_t rxSpikeEvery = 0;        // every Nth frame reads 80 C hot (valid checksum)
+    double ambientC = 20.0;
+    double heatGainCps = 1.6;         // degC/s at 100% heat
+    double lossPerS = 0.004;          // Newton cooling, vent adds up to +50%
+    double sensorLagS = 4.0;          // probe time constant
+};
+
+class SimRoaster {
+public:
+    explicit SimRoaster(const SimRoasterConfig &cfg);
+
+    void start();                     // attach to the wire and start sending
+    void onTxEdge(uint8_t level, uint64_t t);
+
+    // Control state as last seen on the wire
+    uint8_t vent() const { return ctrl[0]; }
+    uint8_t filter() const { return ctrl[1]; }
+    uint8_t cool() const { return ctrl[2]; }
+    uint8_t drum() const { return ctrl[3]; }
+    uint8_t heat() const { return ctrl[4]; }
+    const uint8_t *lastFrame() const { return ctrl; }
+
+    double beanTempC() const { return probeC; }
+
+    // Stats
+    uint32_t framesDecoded = 0;
+    uint32_t framesBadChecksum = 0;
+    uint32_t framesAborted = 0;
+    uint32_t framesSent = 0;
+    uint64_t lastFrameEndUs = 0;
+    uint64_t maxFrameGapUs = 0;
+
+    // Called with the wire time a good control frame finished
+    void (*onFrame)(const uint8_t *frame, uint64_t t) = nullptr;
+
+    // raw X/Y that getTemperature() maps back to tempC
+    static void encodeTemperature(double tempC, uint16_t &rawX, uint16_t &rawY);
+
+private:
+    void step(uint64_t t);
+    void sendFrame(uint64_t t);
+
+    SimRoasterConfig cfg;
+    uint8_t ctrl[6] = {0, 0, 0, 0, 0, 0};
+    double chamberC;
+    double probeC;
+    uint64_t lastStepUs = 0;
+
+    // control frame decoder
+    uint64_t lowStart = 0;
+    bool receiving = false;
+    int bit = 0;
+    uint8_t rx[6];
+};
@@ -0,0 +1,76 @@
+/*
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+// -----------------------------------------------------------------------------
+// The firmware sketch, built as an ordinary translation unit for the host
+// -----------------------------------------------------------------------------
+#include "../src/SkiBeanComm.ino"
+
+// -----------------------------------------------------------------------------
+// In-memory command transport for the script's "@pipe" lines
+// -----------------------------------------------------------------------------
+PipeTransport simPipe;
+
+void simPipeAttach() { registerTransport(simPipe); }
+bool simPipeWrite(const char *line, size_t len) { return simPipe.send(line, len); }
+size_t simPipeRead(char *dst, size_t max) { return simPipe.read(dst, max); }
+
+// -----------------------------------------------------------------------------
+// Firmware-side counters for the end-of-run report
+// -----------------------------------------------------------------------------
+void simFirmwareReport() {
+    printf("frame scheduler    requested %u, sent %u (%u heartbeat), coalesced %u, wire time saved %.1f s\n",
+           frameScheduler.framesRequested(), frameScheduler.framesSent(), frameScheduler.heartbeatFrames(),
+           frameScheduler.framesCoalesced(), frameScheduler.wireTimeSavedUs() / 1e6);
+    printf("notify queue       sent %u, merged %u, dropped %u, write->notify avg %.1f ms, max %.1f ms\n",
+           notifyQueue.sent, notifyQueue.merged, notifyQueue.dropped,
+           notifyQueue.sent ? notifyQueue.sumLatencyUs / 1000.0 / notifyQueue.sent : 0.0,
+           notifyQueue.maxLatencyUs / 1000.0);
+    printf("temp filter        %u samples, BT %.1f C, RoR %.1f C/min (median %u, ema %u%%, window %u s)\n",
+           tempFilter.sampleCount(), tempFilter.temperature('C'), tempFilter.rateOfRise('C'),
+           tempFilter.median(), tempFilter.ema(), tempFilter.rorWindow());
+    printf("pid config         %u commits, %u NVS writes, pending %s\n", myPIDConfig.commits(), simPrefsWrites,
+           myPIDConfig.pending() ? "yes" : "no");
+    const RelayTuner& at = autotune.relay();
+    printf("autotune           state %u result %u, %u cycles in %.0f s, a %.2f C, Ku %.2f %%/C, Pu %.1f s, "
+           "Kp %.2f Ki %.3f Kd %.2f\n", at.state(), at.result(), at.cycles(), at.elapsedMs() / 1000.0,
+           at.amplitudeCentiC() / 100.0, at.ultimateGain(), at.ultimatePeriodS(), myPIDConfig.getKp(),
+           myPIDConfig.getKi(), myPIDConfig.getKd());
+    printf("recorder           %u samples, %u saved, overruns %u, worst append %u us\n",
+           recorder.samples(), recorder.logsSaved(), recorder.overruns(), recorder.maxAppendUs());
+
+    // decoded from the characteristic blob, as a client would see it
+    uint8_t blob[DIAG_BLOB_BYTES];
+    size_t n = diagnosticsBlob(blob);
+    auto le32 = [&](size_t off) { return (uint32_t)blob[off] | blob[off + 1] << 8 | blob[off + 2] << 16 | (uint32_t)blob[off + 3] << 24; };
+    size_t hist = 8 + DIAG_COUNTER_COUNT * 4 + DIAG_CMD_TO_FRAME * (1 + DIAG_BUCKETS) * 4;
+    printf("diagnostics        %zu B, rx %u (%u/s) bad %u ovr %u, tx %u, cmd ring max %u, notify max %u, cmd->frame p50 %.1f ms "
+           "p99 %.1f ms max %.1f ms\n", n, le32(8 + DIAG_RX_FRAMES * 4), le32(8 + DIAG_RX_PER_S * 4),
+           le32(8 + DIAG_RX_BAD_CHECKSUM * 4), le32(8 + DIAG_RX_OVERRUN * 4), le32(8 + DIAG_TX_FRAMES * 4), le32(8 + DIAG_CMD_RING_MAX * 4),
+           le32(8 + DIAG_NOTIFY_MAX * 4), diag.histogram(DIAG_CMD_TO_FRAME).percentileUs(50) / 1000.0,
+           diag.histogram(DIAG_CMD_TO_FRAME).percentileUs(99) / 1000.0, le32(hist) / 1000.0);
+    char text[NOTIFY_SLOT_BYTES];
+    formatDiagnostics(text, sizeof(text));
+    printf("                   %s", text);
+    linkManager.format(text, sizeof(text));
+    printf("link               %s", text + 2);
+    printf("transports        ");
+    for (size_t i = 0; i < transportCount; i++) {
+        printf(" %s %u/%u", transports[i]->name(), transports[i]->replies, transports[i]->repliesDropped);
+    }
+    printf(" replies/dropped\n");
+    printf("sessions           %u open, controller %d, control writes dropped %u\n", sessions.count(),
+           sessions.controller() == BLE_HS_CONN_HANDLE_NONE ? -1 : sessions.controller(), sessions.controlWritesDropped());
+}
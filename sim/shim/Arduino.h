@@ -0,0 +1,226 @@
+/*
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+// -----------------------------------------------------------------------------
+// Host shim for the slice of the Arduino-ESP32 API the firmware uses.
+// Time is virtual: micros()/millis() read the simulator clock and
+// delay()/delayMicroseconds() advance it instead of sleeping (see SimClock.h).
+// -----------------------------------------------------------------------------
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <algorithm>
+#include <cmath>
+#include <string>
+
+#define SKI_NATIVE 1
+
+#define HIGH 0x1
+#define LOW  0x0
+
+#define INPUT        0x01
+#define OUTPUT       0x03
+#define INPUT_PULLUP 0x05
+
+#define RISING  0x01
+#define FALLING 0x02
+#define CHANGE  0x03
+
+#define IRAM_ATTR
+
+#define LED_COLOR_ORDER_RGB 0
+#define LED_COLOR_ORDER_GRB 1
+#define RGB_BUILTIN_LED_COLOR_ORDER LED_COLOR_ORDER_GRB
+
+#define PI 3.1415926535897932384626433832795
+
+using std::min;
+using std::max;
+
+#define constrain(amt, low, high) ((amt) < (low) ? (low) : ((amt) > (high) ? (high) : (amt)))
+#define bitRead(value, bit) (((value) >> (bit)) & 0x01)
+
+// -----------------------------------------------------------------------------
+// String
+// -----------------------------------------------------------------------------
+class String {
+public:
+    String() {}
+    String(const char *s) : s_(s ? s : "") {}
+    String(const std::string &s) : s_(s) {}
+    explicit String(char c) : s_(1, c) {}
+    String(int v) : s_(std::to_string(v)) {}
+    String(unsigned int v) : s_(std::to_string(v)) {}
+    String(long v) : s_(std::to_string(v)) {}
+    String(unsigned long v) : s_(std::to_string(v)) {}
+    String(unsigned char v) : s_(std::to_string(v)) {}
+    String(float v, unsigned int decimals = 2) { fromDouble(v, decimals); }
+    String(double v, unsigned int decimals = 2) { fromDouble(v, decimals); }
+
+    unsigned int length() const { return s_.length(); }
+    const char *c_str() const { return s_.c_str(); }
+    char charAt(unsigned int i) const { return i < s_.length() ? s_[i] : 0; }
+    char operator[](unsigned int i) const { return charAt(i); }
+
+    int indexOf(char c, unsigned int from = 0) const { return find(s_.find(c, from)); }
+    int indexOf(const String &str, unsigned int from = 0) const { return find(s_.find(str.s_, from)); }
+    int lastIndexOf(char c) const { return find(s_.rfind(c)); }
+    int lastIndexOf(const String &str) const { return find(s_.rfind(str.s_)); }
+
+    String substring(unsigned int from) const { return from < s_.length() ? String(s_.substr(from)) : String(); }
+    String substring(unsigned int from, unsigned int to) const {
+        if (from > to) { unsigned int t = from; from = to; to = t; }
+        if (from >= s_.length()) return String();
+        return String(s_.substr(from, to - from));
+    }
+
+    void remove(unsigned int index) { if (index < s_.length()) s_.erase(index); }
+    void remove(unsigned int index, unsigned int count) { if (index < s_.length()) s_.erase(index, count); }
+    void trim();
+    void toUpperCase() { for (auto &c : s_) c = toupper((unsigned char)c); }
+    void toLowerCase() { for (auto &c : s_) c = tolower((unsigned char)c); }
+    long toInt() const { return atol(s_.c_str()); }
+    double toDouble() const { return atof(s_.c_str()); }
+    float toFloat() const { return (float)atof(s_.c_str()); }
+
+    String &operator+=(const String &rhs) { s_ += rhs.s_; return *this; }
+    String &operator+=(const char *rhs) { s_ += rhs; return *this; }
+    String &operator+=(char rhs) { s_ += rhs; return *this; }
+
+    friend String operator+(const String &a, const String &b) { return String(a.s_ + b.s_); }
+    friend String operator+(const String &a, const char *b) { return String(a.s_ + b); }
+    friend String operator+(const char *a, const String &b) { return String(a + b.s_); }
+    friend String operator+(const String &a, char b) { return String(a.s_ + b); }
+
+    bool operator==(const String &rhs) const { return s_ == rhs.s_; }
+    bool operator==(const char *rhs) const { return s_ == rhs; }
+    bool operator!=(const String &rhs) const { return s_ != rhs.s_; }
+    bool operator!=(const char *rhs) const { return s_ != rhs; }
+
+private:
+    static int find(size_t pos) { return pos == std::string::npos ? -1 : (int)pos; }
+    void fromDouble(double v, unsigned int decimals) {
+        char buf[48];
+        snprintf(buf, sizeof(buf), "%.*f", decimals, v);
+        s_ = buf;
+    }
+    std::string s_;
+};
+
+// -----------------------------------------------------------------------------
+// Stream, just what the command transports use
+// -----------------------------------------------------------------------------
+class Stream {
+public:
+    virtual ~Stream() {}
+    virtual int available() = 0;
+    virtual int read() = 0;
+    virtual int availableForWrite() { return 0; }
+    virtual size_t write(uint8_t c) = 0;
+    virtual size_t write(const uint8_t *buf, size_t len) {
+        size_t n = 0;
+        while (n < len && write(buf[n])) n++;
+        return n;
+    }
+};
+
+// -----------------------------------------------------------------------------
+// Serial (goes to stdout)
+// -----------------------------------------------------------------------------
+class HardwareSerial : public Stream {
+public:
+    void begin(unsigned long) {}
+    operator bool() const { return true; }
+    int available() override { return 0; }
+    int read() override { return -1; }
+    int availableForWrite() override { return 4096; }
+    size_t write(uint8_t c) override { return fwrite(&c, 1, 1, stdout); }
+    size_t write(const uint8_t *buf, size_t len) override { return fwrite(buf, 1, len, stdout); }
+    void flush() { fflush(stdout); }
+
+    size_t print(const char *s) { return printf("%s", s); }
+    size_t print(const String &s) { return printf("%s", s.c_str()); }
+    size_t print(char c) { return printf("%c", c); }
+    size_t print(int v) { return printf("%d", v); }
+    size_t print(unsigned int v) { return printf("%u", v); }
+    size_t print(long v) { return printf("%ld", v); }
+    size_t print(unsigned long v) { return printf("%lu", v); }
+    size_t print(double v, int decimals = 2) { return printf("%.*f", decimals, v); }
+    template <typename T> size_t println(const T &v) { size_t n = print(v); return n + printf("\n"); }
+    size_t println() { return printf("\n"); }
+    template <typename... Args> size_t printf(const char *fmt, Args... args) { return ::printf(fmt, args...); }
+    size_t printf(const char *s) { return ::printf("%s", s); }
+};
+extern HardwareSerial Serial;
+
+// -----------------------------------------------------------------------------
+// Time (virtual)
+// -----------------------------------------------------------------------------
+unsigned long micros();
+unsigned long millis();
+void delay(unsigned long ms);
+void delayMicroseconds(unsigned int us);
+inline void yield() {}
+
+// -----------------------------------------------------------------------------
+// GPIO
+// -----------------------------------------------------------------------------
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t val);
+int digitalRead(uint8_t pin);
+void attachInterrupt(uint8_t pin, void (*isr)(void), int mode);
+void detachInterrupt(uint8_t pin);
+inline uint8_t digitalPinToInterrupt(uint8_t pin) { return pin; }
+inline void noInterrupts() {}
+inline void interrupts() {}
+inline void rgbLedWrite(uint8_t, uint8_t, uint8_t, uint8_t) {}
+
+// -----------------------------------------------------------------------------
+// RMT (esp32-hal-rmt.h), driven by the simulated wire
+// -----------------------------------------------------------------------------
+#define SOC_RMT_SUPPORTED 1
+
+typedef enum { RMT_RX_MODE = 0, RMT_TX_MODE = 1 } rmt_ch_dir_t;
+typedef enum {
+    RMT_MEM_NUM_BLOCKS_1 = 1,
+    RMT_MEM_NUM_BLOCKS_2 = 2,
+    RMT_MEM_NUM_BLOCKS_3 = 3,
+    RMT_MEM_NUM_BLOCKS_4 = 4,
+} rmt_reserve_memsize_t;
+
+typedef union {
+    struct {
+        uint32_t duration0 : 15;
+        uint32_t level0 : 1;
+        uint32_t duration1 : 15;
+        uint32_t level1 : 1;
+    };
+    uint32_t val;
+} rmt_data_t;
+
+bool rmtInit(int pin, rmt_ch_dir_t channel_direction, rmt_reserve_memsize_t memsize, uint32_t frequency_Hz);
+bool rmtSetEOT(int pin, uint8_t EOT_Level);
+bool rmtWriteAsync(int pin, rmt_data_t *data, size_t num_rmt_symbols);
+bool rmtTransmitCompleted(int pin);
+bool rmtReadAsync(int pin, rmt_data_t *data, size_t *num_rmt_symbols);
+bool rmtReceiveCompleted(int pin);
+bool rmtSetRxMaxThreshold(int pin, uint16_t idle_thres_ticks);
+bool rmtSetRxMinThreshold(int pin, uint8_t filter_pulse_ticks);
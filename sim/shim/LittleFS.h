@@ -0,0 +1,107 @@
+/*
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+// -----------------------------------------------------------------------------
+// Host shim for the slice of the Arduino-ESP32 LittleFS API the firmware uses.
+// Files live in memory for the life of the process; directories are implied.
+// -----------------------------------------------------------------------------
+
+#include <Arduino.h>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#define FILE_READ   "r"
+#define FILE_WRITE  "w"
+#define FILE_APPEND "a"
+
+namespace fs {
+
+typedef std::vector<uint8_t> SimFileData;
+
+class File {
+public:
+    File() {}
+    File(std::shared_ptr<SimFileData> d, size_t pos, bool writable) : d_(d), pos_(pos), writable_(writable) {}
+
+    explicit operator bool() const { return (bool)d_; }
+    size_t write(const uint8_t *buf, size_t len) {
+        if (!d_ || !writable_) return 0;
+        if (d_->size() < pos_ + len) d_->resize(pos_ + len);
+        memcpy(d_->data() + pos_, buf, len);
+        pos_ += len;
+        return len;
+    }
+    size_t read(uint8_t *buf, size_t len) {
+        if (!d_ || pos_ >= d_->size()) return 0;
+        if (len > d_->size() - pos_) len = d_->size() - pos_;
+        memcpy(buf, d_->data() + pos_, len);
+        pos_ += len;
+        return len;
+    }
+    bool seek(size_t pos) {
+        if (!d_ || pos > d_->size()) return false;
+        pos_ = pos;
+        return true;
+    }
+    size_t position() const { return pos_; }
+    size_t size() const { return d_ ? d_->size() : 0; }
+    void flush() {}
+    void close() { d_.reset(); }
+
+private:
+    std::shared_ptr<SimFileData> d_;
+    size_t pos_ = 0;
+    bool writable_ = false;
+};
+
+class LittleFSFS {
+public:
+    bool begin(bool formatOnFail = false) { (void)formatOnFail; return true; }
+    bool exists(const char *path) { return files_.count(path) > 0; }
+    bool remove(const char *path) { return files_.erase(path) > 0; }
+    bool mkdir(const char *) { return true; }
+
+    File open(const char *path, const char *mode = FILE_READ) {
+        auto it = files_.find(path);
+        if (mode[0] == 'r') {
+            if (it == files_.end()) return File();
+            return File(it->second, 0, mode[1] == '+');
+        }
+        if (mode[0] == 'w' || it == files_.end()) {
+            files_[path] = std::make_shared<SimFileData>();
+            it = files_.find(path);
+        }
+        return File(it->second, mode[0] == 'a' ? it->second->size() : 0, true);
+    }
+
+    size_t totalBytes() const { return 1536 * 1024; }
+    size_t usedBytes() const {
+        size_t n = 0;
+        for (auto &f : files_) n += f.second->size();
+        return n;
+    }
+
+private:
+    std::map<std::string, std::shared_ptr<SimFileData>> files_;
+};
+
+} // namespace fs
+
+using fs::File;
+inline fs::LittleFSFS LittleFS;
@@ -0,0 +1,236 @@
+/*
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+// -----------------------------------------------------------------------------
+// Host shim for the NimBLE-Arduino 2.x server API the firmware uses.
+// There is no radio: the simulator plays the part of the central by calling
+// the server/characteristic callbacks directly, and every notify() is handed
+// to simBleOnNotify so it can be timed.
+// -----------------------------------------------------------------------------
+
+#include <Arduino.h>
+#include <string>
+#include <vector>
+
+#define BLE_HS_CONN_HANDLE_NONE 0xffff
+
+namespace NIMBLE_PROPERTY {
+    const uint16_t READ     = 0x0002;
+    const uint16_t WRITE_NR = 0x0004;
+    const uint16_t WRITE    = 0x0008;
+    const uint16_t NOTIFY   = 0x0010;
+    const uint16_t INDICATE = 0x0020;
+}
+
+class NimBLECharacteristic;
+class NimBLEServer;
+
+// Simulator hook, set by the sim to observe outbound notifications
+extern void (*simBleOnNotify)(NimBLECharacteristic *chr, const uint8_t *data, size_t len, uint16_t connHandle);
+
+class NimBLEAttValue {
+public:
+    NimBLEAttValue() {}
+    NimBLEAttValue(const uint8_t *data, size_t len) : v_((const char *)data, len) {}
+    const char *c_str() const { return v_.c_str(); }
+    const uint8_t *data() const { return (const uint8_t *)v_.data(); }
+    size_t length() const { return v_.length(); }
+    size_t size() const { return v_.length(); }
+private:
+    std::string v_;
+};
+
+class NimBLEConnInfo {
+public:
+    explicit NimBLEConnInfo(uint16_t handle = 0) : handle_(handle), interval_(24), latency_(0), timeout_(500), mtu_(23) {}
+    uint16_t getConnHandle() const { return handle_; }
+    uint16_t getConnInterval() const { return interval_; }
+    uint16_t getConnLatency() const { return latency_; }
+    uint16_t getConnTimeout() const { return timeout_; }
+    uint16_t getMTU() const { return mtu_; }
+
+    // sim side
+    void setParams(uint16_t interval, uint16_t latency, uint16_t timeout) { interval_ = interval; latency_ = latency; timeout_ = timeout; }
+    void setMTU(uint16_t mtu) { mtu_ = mtu; }
+private:
+    uint16_t handle_, interval_, latency_, timeout_, mtu_;
+};
+
+class NimBLEDescriptor {
+public:
+    void setValue(const char *v) { value_ = v; }
+    void setValue(const String &v) { value_ = v.c_str(); }
+private:
+    std::string value_;
+};
+#define BLEDescriptor NimBLEDescriptor
+
+class NimBLECharacteristicCallbacks {
+public:
+    virtual ~NimBLECharacteristicCallbacks() {}
+    virtual void onRead(NimBLECharacteristic *, NimBLEConnInfo &) {}
+    virtual void onWrite(NimBLECharacteristic *, NimBLEConnInfo &) {}
+    virtual void onSubscribe(NimBLECharacteristic *, NimBLEConnInfo &, uint16_t) {}
+};
+
+class NimBLECharacteristic {
+public:
+    NimBLECharacteristic(const char *uuid, uint16_t props) : uuid_(uuid), props_(props), callbacks_(nullptr) {}
+
+    void setCallbacks(NimBLECharacteristicCallbacks *cb) { callbacks_ = cb; }
+    NimBLECharacteristicCallbacks *getCallbacks() const { return callbacks_; }
+    const std::string &getUUID() const { return uuid_; }
+
+    void setValue(const uint8_t *data, size_t len) { value_ = NimBLEAttValue(data, len); }
+    void setValue(const char *s) { setValue((const uint8_t *)s, strlen(s)); }
+    void setValue(const String &s) { setValue(s.c_str()); }
+    void setValue(const std::string &s) { setValue((const uint8_t *)s.data(), s.length()); }
+    NimBLEAttValue getValue() const { return value_; }
+
+    // like NimBLE: to every subscriber, or to one connection if it subscribed
+    bool notify(uint16_t connHandle = BLE_HS_CONN_HANDLE_NONE) {
+        return notify(value_.data(), value_.length(), connHandle);
+    }
+    bool notify(const uint8_t *data, size_t len, uint16_t connHandle = BLE_HS_CONN_HANDLE_NONE) {
+        for (uint16_t h : subscribers_) {
+            if (connHandle != BLE_HS_CONN_HANDLE_NONE && h != connHandle) continue;
+            if (simBleOnNotify) simBleOnNotify(this, data, len, h);
+        }
+        return true;
+    }
+
+    // sim side: a central writes the CCCD
+    void simSubscribe(NimBLEConnInfo &info, bool on) {
+        uint16_t h = info.getConnHandle();
+        for (size_t i = 0; i < subscribers_.size(); i++) {
+            if (subscribers_[i] == h) { subscribers_.erase(subscribers_.begin() + i); break; }
+        }
+        if (on) subscribers_.push_back(h);
+        if (callbacks_) callbacks_->onSubscribe(this, info, on ? 1 : 0);
+    }
+
+    NimBLEDescriptor *createDescriptor(const char *, uint16_t) { descriptors_.push_back(new NimBLEDescriptor()); return descriptors_.back(); }
+    void addDescriptor(NimBLEDescriptor *) {}
+
+private:
+    std::string uuid_;
+    uint16_t props_;
+    NimBLECharacteristicCallbacks *callbacks_;
+    NimBLEAttValue value_;
+    std::vector<NimBLEDescriptor *> descriptors_;
+    std::vector<uint16_t> subscribers_;
+};
+
+class NimBLEService {
+public:
+    explicit NimBLEService(const char *uuid) : uuid_(uuid) {}
+    NimBLECharacteristic *createCharacteristic(const char *uuid, uint16_t props) {
+        chars_.push_back(new NimBLECharacteristic(uuid, props));
+        return chars_.back();
+    }
+    NimBLECharacteristic *getCharacteristic(const char *uuid) {
+        for (auto *c : chars_) if (c->getUUID() == uuid) return c;
+        return nullptr;
+    }
+    bool start() { return true; }
+    void simDrop(uint16_t handle) {
+        NimBLEConnInfo info(handle);
+        for (auto *c : chars_) c->simSubscribe(info, false);
+    }
+private:
+    std::string uuid_;
+    std::vector<NimBLECharacteristic *> chars_;
+};
+
+class NimBLEAdvertising {
+public:
+    bool setName(const std::string &) { return true; }
+    bool start() { advertising_ = true; return true; }
+    bool stop() { advertising_ = false; return true; }
+    bool isAdvertising() const { return advertising_; }
+private:
+    bool advertising_ = false;
+};
+
+class NimBLEServerCallbacks {
+public:
+    virtual ~NimBLEServerCallbacks() {}
+    virtual void onConnect(NimBLEServer *, NimBLEConnInfo &) {}
+    virtual void onDisconnect(NimBLEServer *, NimBLEConnInfo &, int) {}
+    virtual void onMTUChange(uint16_t, NimBLEConnInfo &) {}
+    virtual void onConnParamsUpdate(NimBLEConnInfo &) {}
+};
+
+class NimBLEServer {
+public:
+    NimBLEServer() : callbacks_(nullptr) {}
+    void setCallbacks(NimBLEServerCallbacks *cb) { callbacks_ = cb; }
+    NimBLEServerCallbacks *getCallbacks() const { return callbacks_; }
+    NimBLEService *createService(const char *uuid) { services_.push_back(new NimBLEService(uuid)); return services_.back(); }
+    NimBLEAdvertising *getAdvertising() { return &advertising_; }
+    bool startAdvertising() { return advertising_.start(); }
+    // the simulated central takes every request at its max interval
+    void updateConnParams(uint16_t handle, uint16_t minInterval, uint16_t maxInterval, uint16_t latency, uint16_t timeout) {
+        lastMinInterval = minInterval; lastMaxInterval = maxInterval; lastLatency = latency; lastTimeout = timeout;
+        NimBLEConnInfo info(handle);
+        info.setParams(maxInterval, latency, timeout);
+        if (callbacks_) callbacks_->onConnParamsUpdate(info);
+    }
+    bool setDataLen(uint16_t, uint16_t txOctets) { lastDataLen = txOctets; return true; }
+    bool disconnect(uint16_t handle, uint8_t reason = 0x13) {
+        NimBLEConnInfo info(handle);
+        if (callbacks_) callbacks_->onDisconnect(this, info, reason);
+        for (auto *s : services_) s->simDrop(handle);
+        return true;
+    }
+
+    NimBLECharacteristic *findCharacteristic(const char *uuid) {
+        for (auto *s : services_) if (NimBLECharacteristic *c = s->getCharacteristic(uuid)) return c;
+        return nullptr;
+    }
+
+    uint16_t lastMinInterval = 0, lastMaxInterval = 0, lastLatency = 0, lastTimeout = 0, lastDataLen = 0;
+
+private:
+    NimBLEServerCallbacks *callbacks_;
+    NimBLEAdvertising advertising_;
+    std::vector<NimBLEService *> services_;
+};
+
+class NimBLEDevice {
+public:
+    static bool init(const std::string &) { return true; }
+    static NimBLEServer *createServer() { if (!server_) server_ = new NimBLEServer(); return server_; }
+    static NimBLEServer *getServer() { return server_; }
+    static bool setMTU(uint16_t mtu) { mtu_ = mtu; return true; }
+    static uint16_t getMTU() { return mtu_; }
+private:
+    static inline NimBLEServer *server_ = nullptr;
+    static inline uint16_t mtu_ = 255;
+};
+
+// Host stack call the firmware makes directly. The simulated central already
+// runs at NimBLEDevice::getMTU(), so an exchange is only counted.
+struct ble_gatt_error;
+typedef int ble_gatt_mtu_fn(uint16_t conn_handle, const struct ble_gatt_error *error, uint16_t mtu, void *arg);
+
+inline uint32_t simMtuExchanges = 0;
+
+inline int ble_gattc_exchange_mtu(uint16_t, ble_gatt_mtu_fn *, void *) {
+    simMtuExchanges++;
+    return 0;
+}
@@ -0,0 +1,66 @@
+/*
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+// -----------------------------------------------------------------------------
+// Host shim for the Arduino-ESP32 Preferences (NVS) blob calls. Storage is in
+// memory; simPrefsWrites counts commits so the sim can report flash wear,
+// simPrefsFail makes begin() fail like a full or broken NVS partition.
+// -----------------------------------------------------------------------------
+
+#include <Arduino.h>
+#include <map>
+#include <string>
+#include <vector>
+
+inline std::map<std::string, std::vector<uint8_t>> simPrefsStore;
+inline uint32_t simPrefsWrites = 0;
+inline bool simPrefsFail = false;
+
+class Preferences {
+public:
+    bool begin(const char *name, bool readOnly = false) {
+        if (simPrefsFail) return false;
+        ns_ = name; readOnly_ = readOnly; open_ = true;
+        return true;
+    }
+    void end() { open_ = false; }
+
+    size_t getBytesLength(const char *key) {
+        auto it = simPrefsStore.find(ns_ + "/" + key);
+        return it == simPrefsStore.end() ? 0 : it->second.size();
+    }
+    size_t getBytes(const char *key, void *buf, size_t maxLen) {
+        auto it = simPrefsStore.find(ns_ + "/" + key);
+        if (!open_ || it == simPrefsStore.end() || it->second.size() > maxLen) return 0;
+        memcpy(buf, it->second.data(), it->second.size());
+        return it->second.size();
+    }
+    size_t putBytes(const char *key, const void *value, size_t len) {
+        if (!open_ || readOnly_) return 0;
+        const uint8_t *p = (const uint8_t *)value;
+        simPrefsStore[ns_ + "/" + key].assign(p, p + len);
+        simPrefsWrites++;
+        return len;
+    }
+    bool remove(const char *key) { return open_ && !readOnly_ && simPrefsStore.erase(ns_ + "/" + key) > 0; }
+    bool clear() { return open_ && !readOnly_; }
+
+private:
+    std::string ns_;
+    bool readOnly_ = false;
+    bool open_ = false;
+};
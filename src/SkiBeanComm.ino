@@ -18,14 +18,29 @@
  ***************************************************/
 
 #include <Arduino.h>
-#include <PID_v1.h>
 #include "../lib/SkiPinDefns.h"
 #include "../lib/SerialDebug.h"
+#include "../lib/SkiSync.h"
+#include "../lib/SkiPID.h"
+#include "../lib/SkiDiag.h"
 #include "../lib/SkiBLE.h"
+#include "../lib/SkiTransport.h"
 #include "../lib/SkiLED.h"
+#include "../lib/SkiTX.h"
+#include "../lib/SkiScheduler.h"
+#include "../lib/SkiCapture.h"
+#include "../lib/SkiFilter.h"
+#include "../lib/SkiProfile.h"
+#include "../lib/SkiRecorder.h"
+#include "../lib/SkiAutotune.h"
 #include "../lib/SkiCMD.h"
+#include "../lib/SkiTelemetry.h"
 #include "../lib/SkiPIDConfig.h"
 #include "../lib/SkiParser.h"
+#include "../lib/SkiTasks.h"
+#if SKI_BENCH
+#include "../lib/SkiBench.h"
+#endif
 
 // -----------------------------------------------------------------------------
 // Current Sketch and Release Version (for BLE device info)
@@ -37,18 +52,25 @@ String sketchName = String(__FILE__).substring(String(__FILE__).lastIndexOf('/')
 // -----------------------------------------------------------------------------
 // Global Bean Temperature Variable
 // -----------------------------------------------------------------------------
-double temp          = 0.0; // temperature
+double temp          = 0.0; // filtered temperature, CorF units
 char CorF = 'C';            // default units
+TempFilter tempFilter;      // spike rejection, smoothing and RoR
 
 // -----------------------------------------------------------------------------
 // Instantiate Parser for read messages from roaster
 // -----------------------------------------------------------------------------
 SkyRoasterParser roaster;
 
+// -----------------------------------------------------------------------------
+// Background transmitter for control messages to roaster
+// -----------------------------------------------------------------------------
+RoasterTx roasterTx;
+FrameScheduler frameScheduler(roasterTx);
+
 // -----------------------------------------------------------------------------
 // Track BLE writes from HiBean
 // -----------------------------------------------------------------------------
-std::queue<String> messageQueue;  // Holds commands written by Hibean to us
+CommandRing commandRing;  // Holds commands written by Hibean to us
 
 // -----------------------------------------------------------------------------
 // Setup PID and Config interface
@@ -72,6 +94,7 @@ void setup() {
     // set pinmode on tx for commands to roaster, take it high
     pinMode(TX_PIN, OUTPUT);
     digitalWrite(TX_PIN, HIGH);
+    roasterTx.begin(TX_PIN);
 
     // start parser on rx pin for bean temp readings from roaster
     roaster.begin(RX_PIN);
@@ -80,46 +103,43 @@ void setup() {
     // Start BLE
     initBLE();
 
+#if SKI_SERIAL_CMD
+    // TC4 commands over USB as well, e.g. Artisan on a wired laptop
+    registerTransport(serialTransport);
+#endif
+
     // Set PID to start in MANUAL mode
     myPID.SetMode(MANUAL);
 
-    // clamp output limits to 0-100(% heat), set sample interval 
-    myPID.SetOutputLimits(0.0,myPIDConfig.getMaxPower());
-    myPID.SetSampleTime(myPIDConfig.getSampleTime());
+    // restore saved tunings (defaults if none), clamp output limits to 0-100(% heat), set sample interval
+    if (myPIDConfig.load()) { D_println("PID config restored from NVS"); }
+    myPIDConfig.apply(myPID);
 
     // Ensure heat starts at 0% for safety
     manualHeatLevel = 0;
     handleHEAT(manualHeatLevel);
 
     shutdown();
+
+    // mount the roast log store
+    recorder.begin();
+
+    // latency histograms and counters, read over BLE
+    diag.begin();
+
+#if !SKI_BENCH
+    // hand over to the io/control/housekeeping tasks (or loop() on the host)
+    startTasks();
+#endif
 }
 
 void loop() {
-    // roaster shut down, clear our buffers   
-    if (itsbeentoolong()) { shutdown(); }
-
-    // roaster message found, go get it, validate and update temp
-    if(roaster.msgAvailable()) {
-        uint8_t msg[7];
-        roaster.getMessage(msg);
-
-        if(roaster.validate(msg)) {
-            temp = roaster.getTemperature(msg);
-        } else {
-            D_println("Checksum failed!");
-        }
-    }
-
-    // process incoming ble commands from HiBean, could be read or write
-    while (!messageQueue.empty()) {
-        String msg = messageQueue.front(); //grab the first one
-        messageQueue.pop(); //remove it from the queue
-        parseAndExecuteCommands(msg);  // process the command it
-    }
-
-    // Ensure PID or manual heat control is handled
-    handlePIDControl();
-    
-    // update the led so user knows we're running
-    handleLED();
+#if SKI_BENCH
+    benchSuite();      // tasks never started, see SkiBench.h
+    delay(BENCH_REPEAT_MS);
+#elif SKI_TASKS
+    vTaskDelete(NULL); // the work runs in the tasks started by setup()
+#else
+    runSteps();        // io, control and housekeeping, see SkiTasks.h
+#endif
 }
@@ -0,0 +1,42 @@
+/*
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#pragma once
+
+// -----------------------------------------------------------------------------
+// The one assertion the host tests need: report and carry on, so a run shows
+// every broken check rather than the first. Plus the heap counter.
+// -----------------------------------------------------------------------------
+
+#include <stdint.h>
+#include <stdio.h>
+
+extern int testChecksFailed;
+
+uint32_t testAllocations();       // heap calls so far, see TestAlloc.cpp
+
+const int TEST_REPORT_MAX = 10;   // failed checks printed per run
+
+#define CHECK(cond, ...)                                                          \
+    do {                                                                          \
+        if (!(cond)) {                                                            \
+            if (testChecksFailed++ < TEST_REPORT_MAX) {                           \
+                printf("  %s:%d: %s ", __FILE__, __LINE__, #cond);                \
+                printf(" " __VA_ARGS__);                                          \
+                printf("\n");                                                     \
+            }                                                                     \
+        }                                                                         \
+    } while (0)
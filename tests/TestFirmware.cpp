@@ -0,0 +1,197 @@
+/*
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+// -----------------------------------------------------------------------------
+// Firmware checks against the sketch itself, built as an ordinary translation
+// unit like the sim and the benchmarks
+//   tx_encode    encodeRoasterFrame() against the bit-banged sender it
+//                replaced, pulse for pulse
+//   temp_lut     convertRoasterTemp() against the reference cubics for every
+//                raw X and Y reading, on both sides of the branch
+//   cmd_alloc    every kind of command through parseAndExecuteCommands()
+//                without a single heap call, and how many run per second
+//   pid_commit   a failed NVS write keeps the PID tunings staged for the
+//                next quiet window
+// -----------------------------------------------------------------------------
+
+#include <chrono>
+#include <math.h>
+#include <string.h>
+#include <vector>
+#include "../src/SkiBeanComm.ino"
+#include "SimClock.h"
+#include "TestCheck.h"
+
+namespace {
+
+// The pre-RMT sendRoasterMessage(), replayed on a recorded wire: each LOW
+// starts a pulse and every microsecond spent HIGH after it is its gap
+struct LegacyWire {
+    std::vector<RoasterPulse> pulses;
+    uint32_t totalUs = 0;
+
+    void pulsePin(int duration) {
+        pulses.push_back({ (uint16_t)duration, 0 });
+        totalUs += duration;
+    }
+    void delayHigh(int duration) {
+        pulses.back().highUs += duration;
+        totalUs += duration;
+    }
+};
+
+LegacyWire legacySend(const uint8_t* buf) {
+    LegacyWire w;
+    w.pulsePin(START_PULSE);
+    w.delayHigh(START_DELAY);
+    for (int i = 0; i < CONTROLLER_LENGTH; i++) {
+        for (int j = 0; j < 8; j++) {
+            w.pulsePin(bitRead(buf[i], j) == 1 ? 1500 : PULSE_ZERO);   // the old code's literal 1500
+            w.delayHigh(POST_PULSE_DELAY);
+        }
+    }
+    return w;
+}
+
+} // namespace
+
+void testTxEncode() {
+    uint8_t frames[][CONTROLLER_LENGTH] = {
+        { 0, 0, 0, 0, 0, 0 },                   // off
+        { 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF },
+        { 50, 2, 0, 100, 70, 0 },               // mid roast
+        { 0xA5, 0x5A, 0xA5, 0x5A, 0xA5, 0 },
+    };
+    for (auto& f : frames) {
+        setControlChecksum(f);
+        LegacyWire want = legacySend(f);
+
+        RoasterPulse got[TX_MAX_PULSES];
+        size_t n = encodeRoasterFrame(f, CONTROLLER_LENGTH, got, TX_MAX_PULSES);
+        CHECK(n == want.pulses.size(), "%zu pulses, legacy sent %zu", n, want.pulses.size());
+        for (size_t i = 0; i < n && i < want.pulses.size(); i++) {
+            CHECK(got[i].lowUs == want.pulses[i].lowUs && got[i].highUs == want.pulses[i].highUs,
+                  "pulse %zu: %u/%u us, legacy %u/%u us", i, got[i].lowUs, got[i].highUs,
+                  want.pulses[i].lowUs, want.pulses[i].highUs);
+        }
+        CHECK(roasterFrameDurationUs(got, n) == want.totalUs, "%u us, legacy %u us",
+              roasterFrameDurationUs(got, n), want.totalUs);
+    }
+
+    // too long for the buffer: nothing encoded
+    uint8_t big[TX_MAX_FRAME_BYTES + 1] = {};
+    RoasterPulse out[TX_MAX_PULSES];
+    CHECK(encodeRoasterFrame(big, sizeof(big), out, TX_MAX_PULSES) == 0);
+}
+
+// Every raw reading of each channel, with the other one pinned on either side
+// of the X/Y switch so both branches and the switch itself are covered. The
+// table has to stay within TEMP_LUT_MAX_ERROR_C of the cubic; past the end of
+// the Y table the cubic runs off to millions of degrees and only the clamp
+// is checked.
+const double TEMP_LUT_MAX_ERROR_C = 0.05;
+
+void testTempLut() {
+    const uint16_t pinnedY[] = { 0, TEMP_Y_MIN, TEMP_Y_MIN + 1, 0xFFFF };
+    const uint16_t pinnedX[] = { 0, TEMP_X_MAX, TEMP_X_MAX + 1, 0xFFFF };
+    double worstC = 0, worstF = 0;
+    uint32_t checked = 0, bad = 0;
+
+    auto check = [&](uint16_t x, uint16_t y) {
+        double want = polynomialTemperatureC(x, y);
+        want = fmax(want, -TEMP_CENTI_LIMIT / 100.0);
+        RoasterTemp got = convertRoasterTemp(x, y);
+        double errC = fabs(got.centiC / 100.0 - want);
+        double errF = fabs(got.centiF / 100.0 - (want * 9 / 5 + 32));
+        worstC = fmax(worstC, errC);
+        worstF = fmax(worstF, errF);
+        checked++;
+        // °F is derived from the rounded °C, so it gets the same error x 9/5 plus a rounding step
+        if ((errC > TEMP_LUT_MAX_ERROR_C || errF > TEMP_LUT_MAX_ERROR_C * 9 / 5 + 0.005) && bad++ < 5) {
+            CHECK(false, "raw X %u Y %u: %.3f C / %.3f F, cubic %.3f C", x, y, got.centiC / 100.0,
+                  got.centiF / 100.0, want);
+        }
+    };
+
+    for (uint16_t y : pinnedY) for (uint32_t x = 0; x <= 0xFFFF; x++) check(x, y);
+    for (uint16_t x : pinnedX) for (uint32_t y = 0; y <= 0xFFFF; y++) check(x, y);
+
+    CHECK(bad == 0, "%u readings off by more than %.2f C", bad, TEMP_LUT_MAX_ERROR_C);
+    printf("  %u readings, worst %.4f C / %.4f F\n", checked, worstC, worstF);
+}
+
+// One line per table entry that leaves the roaster, the log and the capture
+// buffer alone, plus the ways a line gets turned away. Each runs once untimed
+// so first-use setup isn't counted, then CMD_ALLOC_RUNS times between two
+// reads of the heap counter.
+const uint32_t CMD_ALLOC_RUNS = 20000;
+
+void testCommandAlloc() {
+    static const char* const lines[] = {
+        "READ", "OT1;0", "OT2;0", "DRUM;0", "COOL;0", "FILTER;0", "UNITS;C", "CHAN", "ESTOP", "OFF",
+        "PID;SV;200", "PID;T;9;0.3;8", "PID;PM;E", "PID;CT;1000", "PID;ON", "PID;OFF", "PID;AT",
+        "BT", "BT;MED;3", "BT;EMA;50", "BT;ROR;30", "PROFILE", "PROFILE;STOP", "LOG", "TASKS",
+        "DIAG", "DIAG;RESET", "LINK", "RX", "RX;ADAPT;1", "RX;RESET", "CAPTURE",
+        "read", " ot1 ; 0 ", "NOPE;1", "PID;T;1", "", ";;;",
+    };
+    setup();
+
+    double totalSeconds = 0;
+    uint32_t totalRuns = 0;
+    for (const char* line : lines) {
+        size_t len = strlen(line);
+        parseAndExecuteCommands(line, len);
+
+        uint32_t before = testAllocations();
+        auto start = std::chrono::steady_clock::now();
+        for (uint32_t i = 0; i < CMD_ALLOC_RUNS; i++) parseAndExecuteCommands(line, len);
+        totalSeconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        uint32_t used = testAllocations() - before;
+        totalRuns += CMD_ALLOC_RUNS;
+        CHECK(used == 0, "\"%s\": %u heap calls in %u runs", line, used, CMD_ALLOC_RUNS);
+    }
+
+    const char batch[] = "OT1;60|OT2;40|DRUM;1|READ";
+    executeCommandBatch(batch, sizeof(batch) - 1);
+    uint32_t before = testAllocations();
+    for (uint32_t i = 0; i < CMD_ALLOC_RUNS; i++) executeCommandBatch(batch, sizeof(batch) - 1);
+    uint32_t used = testAllocations() - before;
+    CHECK(used == 0, "batch \"%s\": %u heap calls in %u runs", batch, used, CMD_ALLOC_RUNS);
+    shutdown();
+
+    printf("  %zu kinds x %u runs, %.0f commands/s\n", sizeof(lines) / sizeof(lines[0]), CMD_ALLOC_RUNS,
+           totalRuns / totalSeconds);
+}
+
+void testPidCommitRetry() {
+    myPIDConfig.setKp(myPIDConfig.getKp() + 1.5);
+    double kp = myPIDConfig.getKp();
+    sim::advanceBy((PID_CONFIG_QUIET_MS + 100) * 1000ULL);
+    CHECK(myPIDConfig.commitDue());
+
+    uint32_t commits = myPIDConfig.commits();
+    simPrefsFail = true;
+    myPIDConfig.commit();
+    simPrefsFail = false;
+    CHECK(myPIDConfig.commits() == commits, "%u commits through a failed NVS", myPIDConfig.commits() - commits);
+    CHECK(myPIDConfig.commitDue(), "tunings dropped after a failed write");
+
+    myPIDConfig.commit();
+    CHECK(myPIDConfig.commits() == commits + 1);
+    CHECK(!myPIDConfig.pending());
+    PIDConfig stored;
+    CHECK(stored.load() && stored.getKp() == kp, "NVS holds Kp %.2f, staged %.2f", stored.getKp(), kp);
+}
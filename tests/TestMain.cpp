@@ -0,0 +1,74 @@
+/*
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+// -----------------------------------------------------------------------------
+// Host tests
+//   ring_*       SpscRing under a real producer and consumer thread (TestRing.cpp)
+//   tx_encode    roaster frame pulses against the old bit-bang (TestFirmware.cpp)
+//   temp_lut     temperature tables against the cubics, every raw reading (TestFirmware.cpp)
+//   cmd_alloc    no heap calls per command, commands/s (TestFirmware.cpp, TestAlloc.cpp)
+//   pid_commit   PID tunings survive a failed NVS write (TestFirmware.cpp)
+//
+//   pio run -e native-test && .pio/build/native-test/program [--pushes N]
+//
+// One line per test, PASS or FAIL with the first few failed checks; the exit
+// status is the number of failed tests.
+// -----------------------------------------------------------------------------
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "TestCheck.h"
+
+void testRingCounters();
+void testRingStress(uint32_t pushes);
+void testTxEncode();
+void testTempLut();
+void testCommandAlloc();
+void testPidCommitRetry();
+
+int testChecksFailed = 0;
+
+namespace {
+
+int failedTests = 0;
+
+template <typename Fn>
+void run(const char* name, Fn fn) {
+    int before = testChecksFailed;
+    fn();
+    bool ok = testChecksFailed == before;
+    if (!ok) failedTests++;
+    printf("%s %s\n", ok ? "PASS" : "FAIL", name);
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    uint32_t pushes = 4000000;
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--pushes") && i + 1 < argc) pushes = strtoul(argv[++i], nullptr, 10);
+    }
+
+    run("ring_counters", [] { testRingCounters(); });
+    run("ring_stress", [&] { testRingStress(pushes); });
+    run("tx_encode", [] { testTxEncode(); });
+    run("temp_lut", [] { testTempLut(); });
+    run("cmd_alloc", [] { testCommandAlloc(); });
+    run("pid_commit", [] { testPidCommitRetry(); });
+    return failedTests;
+}
@@ -0,0 +1,133 @@
+/*
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+// -----------------------------------------------------------------------------
+// SpscRing under load
+// A producer thread pushes numbered messages of varying length as fast as it
+// can, retrying whenever the ring is full, and slips in an oversized one now
+// and then. The consumer thread checks each slot in place before popping it:
+// the sequence number comes next with nothing lost or repeated, and the length,
+// stamp, every payload byte, the checksum and the terminator all belong to that
+// message - a torn slot would mix two of them. At the end the ring's overflow,
+// oversize and high-water counters have to agree with what the threads saw.
+//
+// Run from TestMain.cpp; --pushes N sets the message count.
+// -----------------------------------------------------------------------------
+
+#include <stdint.h>
+#include <string.h>
+#include <thread>
+#include "../lib/SkiRing.h"
+#include "TestCheck.h"
+
+namespace {
+
+// same geometry as the firmware's CommandRing
+typedef SpscRing<128, 16> Ring;
+
+const uint32_t OVERSIZE_EVERY = 1000;
+
+// message n: 4 byte sequence, filler, 1 byte checksum
+size_t messageLen(uint32_t n) { return 6 + n % 120; }
+
+size_t makeMessage(uint32_t n, char* out) {
+    size_t len = messageLen(n);
+    memcpy(out, &n, 4);
+    uint8_t sum = out[0] + out[1] + out[2] + out[3];
+    for (size_t i = 4; i + 1 < len; i++) {
+        out[i] = (char)(n * 31 + i);
+        sum += (uint8_t)out[i];
+    }
+    out[len - 1] = (char)sum;
+    return len;
+}
+
+} // namespace
+
+void testRingCounters() {
+    Ring ring;
+    char msg[128] = "x";
+    for (size_t i = 0; i < ring.capacity(); i++) CHECK(ring.push(msg, 1, i));
+    CHECK(!ring.push(msg, 1, 0), "pushed into a full ring");
+    CHECK(ring.overflows() == 1);
+    CHECK(!ring.push(msg, sizeof(msg), 0), "a slot holds at most 127 bytes");
+    CHECK(ring.oversized() == 1);
+    CHECK(ring.highWaterMark() == ring.capacity());
+
+    for (size_t i = 0; i < 10; i++) ring.pop();
+    CHECK(ring.depth() == ring.capacity() - 10);
+    ring.resetHighWater();
+    CHECK(ring.highWaterMark() == ring.capacity() - 10, "high water %u", ring.highWaterMark());
+
+    for (size_t i = 0; i < ring.capacity(); i++) ring.pop();
+    CHECK(ring.front() == nullptr && ring.depth() == 0);
+    ring.pop();   // popping an empty ring is a no-op
+    CHECK(ring.depth() == 0);
+}
+
+void testRingStress(uint32_t pushes) {
+    static Ring ring;
+    uint64_t fullRetries = 0;
+    uint32_t oversizedSent = 0;
+
+    std::thread producer([&] {
+        char msg[128];
+        char big[200] = {};
+        for (uint32_t n = 0; n < pushes; n++) {
+            if (n % OVERSIZE_EVERY == 0) {
+                if (!ring.push(big, sizeof(big), 0)) oversizedSent++;
+            }
+            size_t len = makeMessage(n, msg);
+            while (!ring.push(msg, len, n)) {
+                fullRetries++;
+                std::this_thread::yield();   // let the consumer in on a single core
+            }
+        }
+    });
+
+    uint32_t received = 0, bad = 0;
+    std::thread consumer([&] {
+        char want[128];
+        while (received < pushes) {
+            Ring::Slot* s = ring.front();
+            if (!s) { std::this_thread::yield(); continue; }
+            size_t len = makeMessage(received, want);
+            bool ok = s->len == len && s->stampUs == received && memcmp(s->data, want, len) == 0 && s->data[len] == '\0';
+            if (!ok && bad++ < 3) {
+                uint32_t seq;
+                memcpy(&seq, s->data, 4);
+                CHECK(ok, "message %u: got seq %u len %u stamp %u", received, seq, s->len, s->stampUs);
+            }
+            ring.pop();
+            received++;
+        }
+    });
+
+    producer.join();
+    consumer.join();
+
+    CHECK(bad == 0, "%u torn or out of order slots", bad);
+    CHECK(received == pushes);
+    CHECK(ring.front() == nullptr, "left over slots");
+    CHECK(ring.overflows() == fullRetries, "overflows %u, producer saw %llu", ring.overflows(),
+          (unsigned long long)fullRetries);
+    CHECK(ring.oversized() == oversizedSent, "oversized %u, producer sent %u", ring.oversized(), oversizedSent);
+    CHECK(ring.highWaterMark() <= ring.capacity());
+    // a push only fails on a full ring, so any overflow means it was full
+    if (fullRetries) CHECK(ring.highWaterMark() == ring.capacity(), "high water %u", ring.highWaterMark());
+    printf("  %u messages, %llu full retries, %u oversized, high water %u/%u\n", received,
+           (unsigned long long)fullRetries, oversizedSent, ring.highWaterMark(), (unsigned)ring.capacity());
+}